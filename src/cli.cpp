@@ -36,7 +36,7 @@
 
 namespace {
 
-  constexpr auto n_options {14U};
+  constexpr auto n_options {23U};
 
   constexpr std::array<struct option, n_options> long_options {{
       // standard options
@@ -55,10 +55,19 @@ namespace {
       {.name="minimum_relative_cooccurence", .has_arg=required_argument, .flag=nullptr, .val='d'},  // deprecated
       {.name="minimum_relative_cooccurrence", .has_arg=required_argument, .flag=nullptr, .val='d'},
       {.name="legacy", .has_arg=no_argument, .flag=nullptr, .val='e'},
+      {.name="grouped_match_list", .has_arg=no_argument, .flag=nullptr, .val='g'},
+      {.name="parent_major", .has_arg=no_argument, .flag=nullptr, .val='p'},
+      {.name="sweep", .has_arg=required_argument, .flag=nullptr, .val='s'},
+      {.name="pair_cache", .has_arg=required_argument, .flag=nullptr, .val='u'},
+      {.name="memory_budget", .has_arg=required_argument, .flag=nullptr, .val='f'},
+      {.name="temporary_directory", .has_arg=required_argument, .flag=nullptr, .val='i'},
 
       // output
       {.name="new_otu_table", .has_arg=required_argument, .flag=nullptr, .val='n'},
       {.name="log", .has_arg=required_argument, .flag=nullptr, .val='l'},
+      {.name="log_level", .has_arg=required_argument, .flag=nullptr, .val='k'},
+      {.name="log_format", .has_arg=required_argument, .flag=nullptr, .val='j'},
+      {.name="log_to_tsv", .has_arg=required_argument, .flag=nullptr, .val='r'},
 
       // mandatory terminal empty option struct
       {.name=nullptr, .has_arg=0, .flag=nullptr, .val=0}
@@ -84,13 +93,22 @@ namespace {
       << "Output options (mandatory):\n"
       << " --new_otu_table FILE                  write an updated OTU table\n"
       << " --log FILE                            record operations\n"
+      << " --log_level STRING                    \"full\", \"accepted\" or \"none\" (\"full\")\n"
+      << " --log_format STRING                   \"tsv\" or \"binary\" (\"tsv\")\n"
+      << " --log_to_tsv FILE                     convert a binary log (write to --log)\n"
       << '\n'
       << "Computation parameters:\n"
       << " --minimum_match FLOAT                 minimum similarity threshold (84.0)\n"
       << " --minimum_ratio FLOAT                 minimum abundance ratio (1.0)\n"
       << " --minimum_ratio_type STRING           \"min\" or \"avg\" abundance ratio (\"min\")\n"
       << " --minimum_relative_cooccurrence FLOAT relative parent-child spread (0.95)\n"
-      << " --legacy                              behave like lulu\n\n"
+      << " --legacy                              behave like lulu\n"
+      << " --grouped_match_list                  match list is grouped by query OTU\n"
+      << " --parent_major                        test potential parents parent by parent\n"
+      << " --sweep FILE                          one new OTU table per parameter set\n"
+      << " --pair_cache FILE                     reuse statistics of pairs of OTUs\n"
+      << " --memory_budget INTEGER               sort buffer for matches, in MiB (no limit)\n"
+      << " --temporary_directory DIR             where to sort matches (TMPDIR or /tmp)\n\n"
       << "See 'man mumu' for more details.\n";
   }
 
@@ -122,7 +140,7 @@ namespace {
 
 auto parse_args(int argc, char ** argv, Parameters &parameters) -> void {
   // C++23 refactor: generate from long_options at compile-time
-  const std::string short_options {"ht:vo:m:a:b:c:d:en:l:"};  // refactoring; string_view?
+  const std::string short_options {"ht:vo:m:a:b:c:d:ef:gi:j:k:n:l:pr:s:u:"};  // refactoring; string_view?
   auto option_character {0};
   auto option_index {0};
 
@@ -162,10 +180,31 @@ auto parse_args(int argc, char ** argv, Parameters &parameters) -> void {
       update_match_threshold(parameters);
       break;
 
+    case 'f':  // memory budget for matches, in MiB (default is 0, no limit)
+      parameters.is_memory_budget = true;
+      parameters.memory_budget = std::stoul(optarg);
+      break;
+
+    case 'g':  // match list is grouped by query (streaming mode)
+      parameters.is_grouped_match_list = true;
+      break;
+
     case 'h':  // help message
       help();
       exit_successfully();
 
+    case 'i':  // temporary directory (default is TMPDIR or /tmp)
+      parameters.temporary_directory = optarg;
+      break;
+
+    case 'j':  // log format (default is "tsv")
+      parameters.log_format = optarg;
+      break;
+
+    case 'k':  // log level (default is "full")
+      parameters.log_level = optarg;
+      break;
+
     case 'l':  // log file (output)
       parameters.log = optarg;
       parameters.is_log = true;
@@ -186,10 +225,29 @@ auto parse_args(int argc, char ** argv, Parameters &parameters) -> void {
       parameters.is_otu_table = true;
       break;
 
+    case 'p':  // group tests by potential parent (scheduling)
+      parameters.is_parent_major = true;
+      break;
+
+    case 'r':  // binary log file (input, conversion mode)
+      parameters.log_to_tsv = optarg;
+      parameters.is_log_to_tsv = true;
+      break;
+
+    case 's':  // parameter sets (sweep mode)
+      parameters.sweep = optarg;
+      parameters.is_sweep = true;
+      break;
+
     case 't':  // threads (default is 1)
       parameters.threads = std::stoul(optarg);
       break;
 
+    case 'u':  // pair statistics cache (input and output)
+      parameters.pair_cache = optarg;
+      parameters.is_pair_cache = true;
+      break;
+
     case 'v':  // version number
       version();
       exit_successfully();
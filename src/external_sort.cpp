@@ -0,0 +1,237 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::clamp, std::ranges::stable_sort
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <span>
+#include <string>
+#include <utility>  // std::pair
+#include <vector>
+#include "mumu.hpp"
+#include "external_sort.hpp"
+#include "load_matches.hpp"
+#include "temporary_file.hpp"
+
+
+namespace {
+
+  constexpr auto mebibyte {std::size_t{1} << 20U};
+  constexpr auto record_size {sizeof(struct Match_record)};
+
+
+  // sorted run of matches, stored in a temporary file
+  class Run_file {
+  public:
+    explicit Run_file(std::string const &directory) : file_ {directory} {}
+
+    auto append(std::span<struct Match_record const> const records) -> void {
+      file_.append(std::as_bytes(records));
+    }
+
+    // fill the buffer with records, starting at 'offset' (in records)
+    auto read(std::size_t const offset,
+              std::span<struct Match_record> const buffer) const -> std::size_t {
+      return file_.read(offset * record_size, std::as_writable_bytes(buffer)) / record_size;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return file_.size() / record_size; }
+
+  private:
+    Temporary_file file_;
+  };
+
+
+  // buffered sequential reader
+  struct Run_reader {
+    Run_file const *run {nullptr};
+    std::vector<struct Match_record> buffer;
+    std::size_t next {0};  // in buffer
+    std::size_t offset {0};  // in run
+
+    auto refill() -> void {
+      buffer.resize(buffer.capacity());
+      buffer.resize(run->read(offset, buffer));
+      offset += buffer.size();
+      next = 0;
+    }
+
+    [[nodiscard]] auto is_done() const -> bool { return next == buffer.size(); }
+
+    auto pop() -> struct Match_record {
+      auto const record = buffer[next];
+      ++next;
+      if (is_done()) { refill(); }
+      return record;
+    }
+  };
+
+
+  // k-way merge: records are ordered by query, then by run (ties are
+  // in input order)
+  template <typename Function>
+  auto merge_runs(std::span<Run_file const * const> const runs,
+                  std::size_t const buffer_size,
+                  Function output) -> void {
+    using Head = std::pair<std::uint32_t, std::size_t>;  // query, run
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    std::vector<struct Run_reader> readers(runs.size());
+    for (auto i {0UL}; i < runs.size(); ++i) {
+      auto &reader = readers[i];
+      reader.run = runs[i];
+      reader.buffer.reserve(buffer_size);
+      reader.refill();
+      if (not reader.is_done()) { heads.emplace(reader.buffer.front().query, i); }
+    }
+    while (not heads.empty()) {
+      auto const run_index = heads.top().second;
+      heads.pop();
+      auto &reader = readers[run_index];
+      output(reader.pop());
+      if (not reader.is_done()) { heads.emplace(reader.buffer[reader.next].query, run_index); }
+    }
+  }
+
+
+  class External_sorter {
+  public:
+    explicit External_sorter(struct Parameters const &parameters)
+      : directory_ {get_temporary_directory(parameters)},
+        budget_ {parameters.memory_budget * mebibyte},
+        // half of the budget is kept for stable sorting
+        max_records_ {std::max(budget_ / record_size / 2, std::size_t{1})} {}
+
+    // the buffer grows with the input (small match lists never
+    // allocate the whole budget), and is spilled when full
+    auto store(std::vector<struct Match_record> const &records) -> void {
+      for (auto const &record : records) {
+        if (buffer_.size() >= max_records_) { spill(); }
+        buffer_.push_back(record);
+      }
+    }
+
+    // pass records to 'output', ordered by query (ties in input order)
+    template <typename Function>
+    auto merge(Function output) -> void {
+      if (runs_.empty()) {  // everything fits in memory
+        std::ranges::stable_sort(buffer_, {}, &Match_record::query);
+        for (auto const &record : buffer_) { output(record); }
+        return;
+      }
+      spill();
+      buffer_ = {};  // release memory before merging
+
+      // merge passes, until runs can be merged at once
+      auto const fan_in = std::clamp(budget_ / (min_buffer_size * record_size),
+                                     std::size_t{2}, max_fan_in);
+      while (runs_.size() > fan_in) {
+        std::deque<Run_file> merged_runs;
+        for (auto first {0UL}; first < runs_.size(); first += fan_in) {
+          auto &merged = merged_runs.emplace_back(directory_);
+          std::vector<struct Match_record> output_buffer;
+          output_buffer.reserve(buffer_size(fan_in));
+          merge_runs(select_runs(first, fan_in), buffer_size(fan_in),
+                     [&](struct Match_record const &record) {
+                       if (output_buffer.size() == output_buffer.capacity()) {
+                         merged.append(output_buffer);
+                         output_buffer.clear();
+                       }
+                       output_buffer.push_back(record);
+                     });
+          merged.append(output_buffer);
+        }
+        runs_.swap(merged_runs);
+      }
+      merge_runs(select_runs(0, runs_.size()), buffer_size(runs_.size()), output);
+    }
+
+  private:
+    static constexpr auto min_buffer_size {std::size_t{1} << 12U};  // in records
+    static constexpr auto max_fan_in {std::size_t{256}};
+
+    // sort the buffer and write it to a new run
+    auto spill() -> void {
+      std::ranges::stable_sort(buffer_, {}, &Match_record::query);
+      runs_.emplace_back(directory_).append(buffer_);
+      buffer_.clear();
+    }
+
+    [[nodiscard]] auto buffer_size(std::size_t const n_runs) const -> std::size_t {
+      // one input buffer per run, and one output buffer
+      return std::max(budget_ / record_size / (n_runs + 1), min_buffer_size);
+    }
+
+    [[nodiscard]] auto select_runs(std::size_t const first,
+                                   std::size_t const count) const
+      -> std::vector<Run_file const *> {
+      std::vector<Run_file const *> selection;
+      for (auto i {first}; i < std::min(first + count, runs_.size()); ++i) {
+        selection.push_back(&runs_[i]);
+      }
+      return selection;
+    }
+
+    std::string directory_;
+    std::size_t budget_ {0};  // in bytes
+    std::size_t max_records_ {1};  // in the sort buffer
+    std::vector<struct Match_record> buffer_;
+    std::deque<Run_file> runs_;  // in input order
+  };
+
+}  // namespace
+
+
+auto sort_match_list_externally(std::vector<struct OTU> &OTUs,
+                                struct Identifiers const &identifiers,
+                                struct Parameters const &parameters,
+                                std::function<void(struct OTU &)> const &visit) -> void {
+  External_sorter sorter {parameters};
+  read_match_records(OTUs, identifiers, parameters,
+                     [&sorter](std::vector<struct Match_record> const &records) {
+                       sorter.store(records);
+                     });
+
+  // rebuild the match list of each query OTU, one at a time
+  auto current_query {std::numeric_limits<std::uint32_t>::max()};
+  auto release = [&](std::uint32_t const query) {
+    if (query == std::numeric_limits<std::uint32_t>::max()) { return; }
+    visit(OTUs[query]);
+    OTUs[query].matches = {};
+  };
+  sorter.merge([&](struct Match_record const &record) {
+    if (record.query != current_query) {
+      release(current_query);
+      current_query = record.query;
+    }
+    OTUs[record.query].matches.push_back(Match {
+        .similarity = record.similarity,
+        .hit = record.hit,
+        .rank = 0});
+  });
+  release(current_query);
+}
@@ -0,0 +1,34 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <functional>
+#include <vector>
+
+// group matches by query OTU with a bounded amount of memory: sorted
+// runs of matches are written to temporary files and merged. Query
+// OTUs are passed to 'visit' in OTU table order, with their matches
+// in match list order, and then released
+auto sort_match_list_externally(std::vector<struct OTU> &OTUs,
+                                struct Identifiers const &identifiers,
+                                struct Parameters const &parameters,
+                                std::function<void(struct OTU &)> const &visit) -> void;
@@ -22,16 +22,25 @@
 // France
 
 #include <algorithm>  // std::ranges::count
+#include <charconv>  // std::from_chars
+#include <cstdint>  // std::uint32_t
 #include <cstdio>  // std::size_t
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <functional>  // std::ref
+#include <limits>
 #include <numeric>
 #include <ranges>
-#include <sstream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <system_error>  // std::errc
+#include <thread>
 #include <utility>  // std::move
+#include <vector>
 #include "mumu.hpp"
+#include "mapped_file.hpp"
+#include "ratios.hpp"
 #include "utils.hpp"
 
 
@@ -67,93 +76,315 @@ namespace {
   }
 
 
-  auto skip_left_quote(std::string const &line,
+  auto skip_left_quote(std::string_view const line,
                        std::size_t const first_sep) -> std::size_t {
     static constexpr auto quote = '"';
-    auto const has_sep = first_sep != std::string::npos;
-    auto const starts_with_quote = line.front() == quote;
+    auto const has_sep = first_sep != std::string_view::npos;
+    auto const starts_with_quote = line.starts_with(quote);
     return (has_sep and starts_with_quote) ? std::size_t{1} : std::size_t{0};
   }
 
 
-  auto skip_right_quote(std::string const &line,
+  auto skip_right_quote(std::string_view const line,
                         std::size_t const first_sep) -> std::size_t {
     static constexpr auto quote = '"';
-    auto const has_sep = first_sep != std::string::npos;
+    auto const has_sep = first_sep != std::string_view::npos;
     // cases: ID, empty
     if (not has_sep) { return first_sep; }
     // case: \t
     if (first_sep == 0) { return first_sep; }
     // cases: I\t, "\t, ID"\t, ID\t, ""\t
-    auto const ends_with_quote = (line.at(first_sep - 1) == quote);
+    auto const ends_with_quote = (line[first_sep - 1] == quote);
     return ends_with_quote ? first_sep - 1 : first_sep;
   }
 
 
-  auto get_OTU_id(std::string const &line,
-                  std::size_t const first_sep) -> std::string {
+  auto get_OTU_id(std::string_view const line,
+                  std::size_t const first_sep) -> std::string_view {
     auto const id_start = skip_left_quote(line, first_sep);
     auto const id_count = skip_right_quote(line, first_sep) - id_start;
     return line.substr(id_start, id_count);
   }
 
 
-  auto parse_each_otu(std::unordered_map<std::string, struct OTU> &OTUs,
-                      std::string const &line,
-                      unsigned int const n_samples,
-                      unsigned long int const ticker) -> void {
-    auto const first_sep {line.find_first_of(sepchar)};
-    auto const OTU_id = get_OTU_id(line, first_sep);
+  [[nodiscard]]
+  auto is_blank(char const character) -> bool {
+    // same set as std::isspace in the "C" locale
+    return character == ' ' or (character >= '\t' and character <= '\r');
+  }
 
-    // strengthening: check for empty OTU_id?
-    // check for duplicates
-    if (OTUs.contains(OTU_id)) {
-      fatal("duplicated OTU name: " + OTU_id);
+
+  // parse whitespace-separated abundance values, and stop at the
+  // first token that is not an integer. That is what
+  // std::istream_view<unsigned long int> used to do: signs are
+  // accepted (-1 wraps to 2^64 - 1), decimals are floored (5.9 -> 5,
+  // and parsing stops at '.9'), overflows stop the parsing.
+  auto parse_abundances(std::string_view const abundances,
+                        std::vector<unsigned long int> &samples) -> void {
+    auto const * position = abundances.data();
+    auto const * const end = position + abundances.size();
+    while (true) {
+      while (position != end and is_blank(*position)) { ++position; }
+      if (position == end) { return; }
+      auto const is_negative = *position == '-';
+      if (is_negative or *position == '+') { ++position; }
+      auto abundance {0UL};
+      auto const [next, error] = std::from_chars(position, end, abundance);
+      if (error != std::errc{}) { return; }
+      samples.push_back(is_negative ? 0UL - abundance : abundance);
+      position = next;
     }
+  }
+
+
+  struct Entry {
+    std::string_view OTU_id;
+    struct OTU otu;
+    bool is_complete {false};  // one abundance value per sample
+  };
+
+
+  // OTUs are first stored in sparse mode: only non-null abundance
+  // values are kept, with their sample index ('samples' is a scratch
+  // buffer, reused from one line to the next)
+  [[nodiscard]]
+  auto parse_each_otu(std::string_view const line,
+                      unsigned int const n_samples,
+                      std::vector<unsigned long int> &samples) -> struct Entry {
+    auto const first_sep {line.find_first_of(sepchar)};
 
     // get abundance values (rest of the line, we know there are n samples)
+    samples.clear();
+    parse_abundances(line.substr(first_sep + 1), samples);
+
+    // add more results (an incomplete OTU is rejected later on)
+    auto has_reads = [](auto const n_reads) -> bool { return n_reads != 0; };
     OTU otu;
-    otu.input_order = ticker;
-    otu.samples.reserve(n_samples);
-    std::stringstream abundances {line.substr(first_sep + 1)};
-    for (auto const abundance : std::ranges::istream_view<unsigned long int>(abundances)) {
-      otu.samples.push_back(abundance);
+    otu.is_sparse = true;
+    otu.spread = static_cast<unsigned int>(std::ranges::count_if(samples, has_reads));
+    otu.sum_reads = std::accumulate(samples.begin(), samples.end(), 0UL);
+    otu.samples.reserve(otu.spread);
+    otu.columns.reserve(otu.spread);
+    for (auto column {0U}; auto const abundance : samples) {
+      if (abundance != 0) {
+        otu.samples.push_back(abundance);
+        otu.columns.push_back(column);
+      }
+      ++column;
+    }
+    return {.OTU_id = get_OTU_id(line, first_sep),
+            .otu = std::move(otu),
+            .is_complete = samples.size() == n_samples};
+  }
+
+
+  auto add_OTU(std::vector<struct OTU> &OTUs,
+               struct Identifiers &identifiers,
+               struct Entry &&entry) -> void {
+    auto &[OTU_id, otu, is_complete] = entry;
+    // strengthening: check for empty OTU_id?
+    // check for duplicates
+    if (identifiers.index.contains(OTU_id)) {
+      fatal("duplicated OTU name: " + std::string{OTU_id});
     }
 
     // sanity check
-    if (otu.samples.size() != n_samples) {
+    if (not is_complete) {
       fatal("variable number of columns in OTU table");
     }
 
-    // add more results to the map
-    auto has_reads = [](auto const n_reads) -> bool { return n_reads != 0; };
-    otu.spread = static_cast<unsigned int>(std::ranges::count_if(otu.samples, has_reads));
-    otu.sum_reads = std::accumulate(otu.samples.begin(), otu.samples.end(), 0UL);
-    OTUs[OTU_id] = std::move(otu);
+    // intern OTU_id (arena capacity is reserved: views remain valid)
+    auto const offset = identifiers.arena.size();
+    identifiers.arena.append(OTU_id);
+    otu.id = std::string_view{identifiers.arena}.substr(offset, OTU_id.size());
+    identifiers.index.emplace(otu.id, static_cast<std::uint32_t>(OTUs.size()));
+    OTUs.push_back(std::move(otu));
+  }
+
+
+  auto expand(struct OTU &otu,
+              unsigned int const n_samples) -> void {
+    static constexpr auto bits_per_word {64U};
+    std::vector<unsigned long int> samples(n_samples, 0);
+    std::vector<std::uint64_t> presence((n_samples + bits_per_word - 1) / bits_per_word, 0);
+    for (auto i {0UL}; i < otu.columns.size(); ++i) {
+      auto const column = otu.columns[i];
+      samples[column] = otu.samples[i];
+      presence[column / bits_per_word] |= std::uint64_t{1} << (column % bits_per_word);
+    }
+    otu.samples = std::move(samples);
+    otu.presence = std::move(presence);
+    // low-incidence OTUs keep the list of samples where they are present
+    if (not is_low_incidence(otu.spread, n_samples)) {
+      otu.columns = {};  // release memory
+    }
+    otu.is_sparse = false;
+  }
+
+
+  auto choose_storage_mode(std::vector<struct OTU> &OTUs,
+                           unsigned int const n_samples) -> void {
+    // sparse storage uses 12 bytes per non-null value, and dense
+    // storage 8 bytes per value: switch to dense storage when most
+    // values are non-null
+    static constexpr auto sparse_density_threshold {0.5};
+    auto n_values {0UL};
+    for (auto const &otu : OTUs) { n_values += otu.spread; }
+    auto const n_cells = static_cast<double>(OTUs.size()) * n_samples;
+    if (static_cast<double>(n_values) <= sparse_density_threshold * n_cells) { return; }
+    for (auto &otu : OTUs) {
+      expand(otu, n_samples);
+    }
+  }
+
+
+  [[nodiscard]]
+  auto parse_header(std::string const &line,
+                    std::string &header) -> unsigned int {
+    header = line;
+    auto const n_samples {count_samples(line)};
+    check_number_of_samples(n_samples);
+    check_if_csv(line);
+    return n_samples;
+  }
+
+
+  // partial OTU set, built by one thread from a block of lines. OTU
+  // names point into the memory-mapped table, or into 'names' when
+  // the table is streamed
+  struct Chunk {
+    std::string_view lines;
+    std::deque<std::string> names;
+    std::vector<struct Entry> OTUs;
+  };
+
+
+  [[nodiscard]]
+  auto split_into_chunks(std::string_view const buffer,
+                         unsigned long int const n_threads) -> std::vector<struct Chunk> {
+    std::vector<struct Chunk> chunks;
+    for (auto const lines : split_lines(buffer, n_threads)) {
+      chunks.push_back(Chunk {.lines = lines, .names = {}, .OTUs = {}});
+    }
+    return chunks;
+  }
+
+
+  auto parse_chunk(struct Chunk &chunk,
+                   unsigned int const n_samples) -> void {
+    // stop at the first incomplete OTU, it is reported during merging
+    std::vector<unsigned long int> samples;
+    samples.reserve(n_samples);
+    auto buffer {chunk.lines};
+    while (not buffer.empty()) {
+      chunk.OTUs.push_back(parse_each_otu(next_line(buffer), n_samples, samples));
+      if (not chunk.OTUs.back().is_complete) { return; }
+    }
+  }
+
+
+  // merge partial OTU sets in input order: errors are reported as if
+  // lines had been parsed one after the other
+  auto merge_chunks(std::vector<struct OTU> &OTUs,
+                    struct Identifiers &identifiers,
+                    std::vector<struct Chunk> &chunks) -> void {
+    auto n_OTUs {0UL};
+    auto arena_size {0UL};
+    for (auto const &chunk : chunks) {
+      n_OTUs += chunk.OTUs.size();
+      for (auto const &entry : chunk.OTUs) { arena_size += entry.OTU_id.size(); }
+    }
+    if (n_OTUs > std::numeric_limits<std::uint32_t>::max()) {
+      fatal("too many OTUs in OTU table");
+    }
+    identifiers.arena.reserve(arena_size);
+    identifiers.index.reserve(n_OTUs);
+    OTUs.reserve(n_OTUs);
+    for (auto &chunk : chunks) {
+      for (auto &entry : chunk.OTUs) {
+        add_OTU(OTUs, identifiers, std::move(entry));
+      }
+      chunk.OTUs = {};  // release memory
+    }
+  }
+
+
+  auto read_mapped_table(std::vector<struct OTU> &OTUs,
+                         struct Identifiers &identifiers,
+                         std::string_view buffer,
+                         struct Parameters const &parameters,
+                         std::string &header) -> unsigned int {
+    auto const n_samples {parse_header(std::string{next_line(buffer)}, header)};
+
+    // parse blocks of lines in parallel
+    auto chunks {split_into_chunks(buffer, parameters.threads)};
+    {
+      std::vector<std::jthread> workers;
+      workers.reserve(chunks.size() - 1);
+      for (auto &chunk : chunks | std::views::drop(1)) {
+        workers.emplace_back(parse_chunk, std::ref(chunk), n_samples);
+      }
+      parse_chunk(chunks.front(), n_samples);
+    }  // jthreads join here
+
+    merge_chunks(OTUs, identifiers, chunks);
+    return n_samples;
+  }
+
+
+  auto read_streamed_table(std::vector<struct OTU> &OTUs,
+                           struct Identifiers &identifiers,
+                           struct Parameters const &parameters,
+                           std::string &header) -> unsigned int {
+    // input file, buffer
+    std::ifstream otu_table {parameters.otu_table};
+    std::string line;
+    std::vector<unsigned long int> samples;
+
+    // first line
+    std::getline(otu_table, line);
+    auto const n_samples {parse_header(line, header)};
+    samples.reserve(n_samples);
+
+    // parse other lines (stop at the first incomplete OTU), keep a
+    // copy of OTU names
+    std::vector<struct Chunk> chunks(1);
+    auto &chunk = chunks.front();
+    while (std::getline(otu_table, line)) {
+      auto &entry = chunk.OTUs.emplace_back(parse_each_otu(line, n_samples, samples));
+      entry.OTU_id = chunk.names.emplace_back(entry.OTU_id);
+      if (not entry.is_complete) { break; }
+    }
+
+    merge_chunks(OTUs, identifiers, chunks);
+    return n_samples;
   }
 
 } // namespace
 
 
-auto read_otu_table(std::unordered_map<std::string, struct OTU> &OTUs,
-                    struct Parameters const &parameters) -> void {
+auto read_otu_table(std::vector<struct OTU> &OTUs,
+                    struct Identifiers &identifiers,
+                    struct Parameters const &parameters,
+                    std::string &header) -> unsigned int {
   std::cout << "parse OTU table... ";
-  // input and output files, buffer
-  std::ifstream otu_table {parameters.otu_table};
-  std::string line;
-
-  // first line
-  std::getline(otu_table, line);
-  output_first_line(line, parameters);
-  auto const n_samples {count_samples(line)};
-  check_number_of_samples(n_samples);
-  check_if_csv(line);
-
-  // parse other lines, and map the values
-  auto ticker {1UL};
-  while (std::getline(otu_table, line)) {
-    parse_each_otu(OTUs, line, n_samples, ticker);
-    ++ticker;
-  }
+  // regular files are scanned in place, pipes and other streams are
+  // read line by line
+  Mapped_file const otu_table {parameters.otu_table};
+  auto const n_samples = otu_table.is_mapped() ?
+    read_mapped_table(OTUs, identifiers, otu_table.contents(), parameters, header) :
+    read_streamed_table(OTUs, identifiers, parameters, header);
+  choose_storage_mode(OTUs, n_samples);
   std::cout << "done, " << OTUs.size() << " entries\n";
+  return n_samples;
+}
+
+
+auto read_otu_table(std::vector<struct OTU> &OTUs,
+                    struct Identifiers &identifiers,
+                    struct Parameters const &parameters) -> unsigned int {
+  std::string header;
+  auto const n_samples {read_otu_table(OTUs, identifiers, parameters, header)};
+  output_first_line(header, parameters);
+  return n_samples;
 }
@@ -22,7 +22,17 @@
 // France
 
 #include <string>
-#include <unordered_map>
+#include <vector>
 
-auto read_otu_table (std::unordered_map<std::string, struct OTU> &OTUs,
-                     struct Parameters const &parameters) -> void;
+// returns the number of samples (the header line is written to the
+// new OTU table)
+auto read_otu_table (std::vector<struct OTU> &OTUs,
+                     struct Identifiers &identifiers,
+                     struct Parameters const &parameters) -> unsigned int;
+
+// same, the header line is only copied to 'header' (--sweep: the new
+// OTU table is not written)
+auto read_otu_table (std::vector<struct OTU> &OTUs,
+                     struct Identifiers &identifiers,
+                     struct Parameters const &parameters,
+                     std::string &header) -> unsigned int;
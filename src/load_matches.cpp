@@ -21,115 +21,347 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
-#include <algorithm>
+#include <algorithm>  // std::ranges::find_if
+#include <charconv>  // std::from_chars
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
 #include <fstream>
+#include <functional>  // std::function, std::ref, std::cref
 #include <iostream>
-#include <sstream>
-#include <stdexcept>
+#include <optional>
+#include <ranges>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <system_error>  // std::errc
+#include <thread>
+#include <vector>
 #include "mumu.hpp"
+#include "load_matches.hpp"
+#include "mapped_file.hpp"
 #include "utils.hpp"
 
 
 namespace {
 
-  auto check_n_columns(std::string const & line) -> void {
-    static constexpr auto expected_n_sepchar = 2;
-    auto const count = std::ranges::count(line, sepchar);
-    if (count != expected_n_sepchar) {
-      fatal("match list entry does not have three columns: " + line);
+  struct Match_line {
+    std::string_view query;
+    std::string_view hit;
+    std::string_view similarity;
+  };
+
+
+  // matches, warnings and errors found in a block of lines, in input
+  // order
+  struct Chunk {
+    std::string_view lines;
+    std::vector<struct Match_record> matches;
+    std::vector<std::string_view> unknown_OTUs;  // lines to warn about
+    std::string error;  // parsing stops at the first malformed line
+  };
+
+
+  auto split_columns(std::string_view const line) -> std::optional<struct Match_line> {
+    auto const first_sepchar = line.find(sepchar);
+    auto const second_sepchar = (first_sepchar == std::string_view::npos) ?
+      first_sepchar : line.find(sepchar, first_sepchar + 1);
+    if (second_sepchar == std::string_view::npos or
+        line.find(sepchar, second_sepchar + 1) != std::string_view::npos) {
+      return std::nullopt;
     }
+    return Match_line {
+      .query = line.substr(0, first_sepchar),
+      .hit = line.substr(first_sepchar + 1, second_sepchar - first_sepchar - 1),
+      .similarity = line.substr(second_sepchar + 1)};
   }
 
 
-  // C++17 refactoring: replace with std::from_chars
-  auto extract_similarity(std::string const & buf,
-                          std::string const & line) -> double {
-    if (buf.empty()) {
-      fatal("empty similarity value in line: " + line);
+  // mimic std::stod: skip leading whitespace, accept an explicit '+'
+  // sign and hexadecimal values, ignore trailing characters
+  auto extract_similarity(std::string_view buffer) -> std::optional<double> {
+    auto const is_space = [](char const character) {
+      return character == ' ' or (character >= '\t' and character <= '\r');
+    };
+    while (not buffer.empty() and is_space(buffer.front())) {
+      buffer.remove_prefix(1);
+    }
+    if (buffer.starts_with('+') and not buffer.starts_with("+-")) {
+      buffer.remove_prefix(1);
     }
-    try {
-      static_cast<void>(std::stod(buf));
-    } catch ([[maybe_unused]] std::invalid_argument const& ex) {
-      fatal("illegal similarity value in line: " + line);
+    auto const is_negative = buffer.starts_with('-');
+    auto const digits = buffer.substr(is_negative ? 1 : 0);
+    auto similarity {0.0};
+    if (digits.starts_with("0x") or digits.starts_with("0X")) {
+      // hexadecimal float: "0x" alone reads as zero
+      static constexpr auto prefix_length = std::size_t{2};
+      auto const hexadecimal = digits.substr(prefix_length);
+      auto const [ptr, error_code] = std::from_chars(
+          hexadecimal.data(), hexadecimal.data() + hexadecimal.size(),
+          similarity, std::chars_format::hex);
+      if (error_code == std::errc::result_out_of_range) { return std::nullopt; }
+      return is_negative ? -similarity : similarity;
     }
-    return std::stod(buf);
+    auto const [ptr, error_code] = std::from_chars(
+        buffer.data(), buffer.data() + buffer.size(), similarity);
+    if (error_code != std::errc{}) { return std::nullopt; }
+    return similarity;
   }
 
-}  // namespace
 
-// // work in progress: use operator overload to parse match list file
-// #include <numeric>
-// struct Match_line {
-//   std::string query;
-//   std::string hit;
-//   float similarity {0.0};
-// };
-
-// std::istream& operator>>(std::istream& is, Match_line& line) {
-//   Match_line new_line;
-//   if(is >> std::ws
-//      && std::getline(is, new_line.query, sepchar)
-//      && std::getline(is, new_line.hit, sepchar)
-//      && std::getline(is, new_line.similarity, sepchar))  // similarity = std::stof(buf); !!
-//     {
-//       line = new_line; // could do more validation here
-//     }
-//   return is;
-// }
-
-
-auto read_match_list(std::unordered_map<std::string, struct OTU> &OTUs,
-                     struct Parameters const &parameters) -> void {
-  std::cout << "parse match list... ";
-  // open input file
-  std::ifstream match_list {parameters.match_list};
+  // OTUs and identifiers are shared by all threads, read-only
+  auto parse_each_match(std::vector<struct OTU> const &OTUs,
+                        struct Identifiers const &identifiers,
+                        struct Parameters const &parameters,
+                        std::string_view const line,
+                        struct Chunk &chunk) -> bool {
+    auto const columns = split_columns(line);
+    if (not columns) {
+      chunk.error = "match list entry does not have three columns: " + std::string{line};
+      return false;
+    }
+    auto const [query, hit, buffer] = *columns;
+    if (buffer.empty()) {
+      chunk.error = "empty similarity value in line: " + std::string{line};
+      return false;
+    }
+    auto const similarity {extract_similarity(buffer)};
+    if (not similarity) {
+      chunk.error = "illegal similarity value in line: " + std::string{line};
+      return false;
+    }
 
-  // expect three columns
-  std::string line;
-  while (std::getline(match_list, line))
+    // ignore matches below our similarity threshold (no lookup)
+    if (*similarity < parameters.minimum_match) { return true; }
+
+    // ignore match entries that are not in the OTU table
+    auto const hit_index = identifiers.index.find(hit);
+    if (hit_index == identifiers.index.end()) {
+      chunk.unknown_OTUs.push_back(line);
+      return true;
+    }
+    auto const query_index = identifiers.index.find(query);
+    if (query_index == identifiers.index.end()) {
+      chunk.unknown_OTUs.push_back(line);
+      return true;
+    }
+
+    // ignore matches to lesser abundant OTUs
+    if (OTUs[query_index->second].sum_reads >= OTUs[hit_index->second].sum_reads) {
+      return true;
+    }
+
+    // // refactoring: ignore matches to or from empty OTUs
+    // if (query_otu.sum_reads == 0 or hit_otu.sum_reads == 0) {
+    //   return true;
+    // }
+
+    chunk.matches.push_back({
+        .similarity = *similarity,
+        .query = query_index->second,
+        .hit = hit_index->second});
+    return true;
+  }
+
+
+  auto parse_chunk(std::vector<struct OTU> const &OTUs,
+                   struct Identifiers const &identifiers,
+                   struct Parameters const &parameters,
+                   struct Chunk &chunk) -> void {
+    auto buffer {chunk.lines};
+    while (not buffer.empty()) {
+      if (not parse_each_match(OTUs, identifiers, parameters,
+                               next_line(buffer), chunk)) { return; }
+    }
+  }
+
+
+  auto append_matches(std::vector<struct OTU> &OTUs,
+                      std::vector<struct Match_record> const &matches) -> void {
+    for (auto const &[similarity, query, hit] : matches) {
+      OTUs[query].matches.push_back(Match {
+          .similarity = similarity,
+          .hit = hit,
+          .rank = 0}
+        );  // no need to reserve(10)?
+    }
+  }
+
+
+  // single-threaded: matches are stored, and warnings and errors
+  // reported, as if lines had been parsed one after the other
+  auto scatter_matches(struct Chunk const &chunk,
+                       Match_sink const &store) -> void {
+    for (auto const line : chunk.unknown_OTUs) {
+      warn("one of these is not in the OTU table: ", std::string{line});
+    }
+    store(chunk.matches);
+    if (not chunk.error.empty()) { fatal(chunk.error); }
+  }
+
+
+  auto parse_block(std::vector<struct OTU> const &OTUs,
+                   struct Identifiers const &identifiers,
+                   struct Parameters const &parameters,
+                   std::string_view const block,
+                   Match_sink const &store) -> void {
+    std::vector<struct Chunk> chunks;
+    for (auto const lines : split_lines(block, parameters.threads)) {
+      chunks.push_back(Chunk {.lines = lines, .matches = {},
+                              .unknown_OTUs = {}, .error = {}});
+    }
     {
-      check_n_columns(line);
-      std::string query;
-      std::string hit;
-      std::string buf;
-      std::stringstream match_raw_data(line);
-      std::getline(match_raw_data, query, sepchar);
-      std::getline(match_raw_data, hit, sepchar);
-      std::getline(match_raw_data, buf, sepchar);
-
-      auto const similarity {extract_similarity(buf, line)};
-
-      // ignore matches below our similarity threshold
-      if (similarity < parameters.minimum_match) { continue; }
-
-      // ignore match entries that are not in the OTU table
-      if ((not OTUs.contains(hit)) or (not OTUs.contains(query))) {
-        warn("one of these is not in the OTU table: ", line);
-        continue;
+      std::vector<std::jthread> workers;
+      workers.reserve(chunks.size() - 1);
+      for (auto &chunk : chunks | std::views::drop(1)) {
+        workers.emplace_back(parse_chunk, std::cref(OTUs), std::cref(identifiers),
+                             std::cref(parameters), std::ref(chunk));
       }
+      parse_chunk(OTUs, identifiers, parameters, chunks.front());
+    }  // jthreads join here
+    for (auto const &chunk : chunks) {
+      scatter_matches(chunk, store);
+    }
+  }
 
-      auto const &hit_otu = OTUs[hit];
-      auto &query_otu = OTUs[query];
 
-      // ignore matches to lesser abundant OTUs
-      if (query_otu.sum_reads >= hit_otu.sum_reads) {
-        continue;
+  // large blocks of complete lines (the last line of a block might
+  // not end with a newline): mapped files are read in place, streams
+  // are copied
+  auto for_each_block(std::string const &file_name,
+                      std::function<void(std::string_view)> const &visit) -> void {
+    static constexpr auto block_size {std::size_t{1} << 26U};  // 64 MiB
+    Mapped_file const match_list {file_name};
+    if (match_list.is_mapped()) {
+      auto buffer {match_list.contents()};
+      while (not buffer.empty()) {
+        auto const end_of_line = buffer.find('\n', std::min(block_size, buffer.size()) - 1);
+        auto const length = std::min(end_of_line, buffer.size() - 1) + 1;
+        visit(buffer.substr(0, length));
+        match_list.release(buffer.substr(0, length));
+        buffer.remove_prefix(length);
       }
+      return;
+    }
+
+    std::ifstream match_list_stream {file_name};
+    std::string line;
+    std::string block;
+    block.reserve(block_size);
+    while (std::getline(match_list_stream, line)) {
+      block.append(line).push_back('\n');
+      if (block.size() >= block_size) {
+        visit(block);
+        block.clear();
+      }
+    }
+    visit(block);
+  }
 
-      // // refactoring: ignore matches to or from empty OTUs
-      // if (OTUs[query].sum_reads == 0 or hit_otu.sum_reads == 0) {
-      //   continue;
-      // }
 
-      query_otu.matches.push_back(Match {
-          .similarity = similarity,
-          .hit_sum_reads = hit_otu.sum_reads,
-          .hit_spread = hit_otu.spread,
-          .hit_input_order = hit_otu.input_order,
-          .hit_id = hit}
-        );  // no need to reserve(10)?
+  auto first_column(std::string_view const line) -> std::string_view {
+    auto const end_of_column = std::ranges::find_if(
+        line, [](char const character) { return character == sepchar or character == '\n'; });
+    return line.substr(0, static_cast<std::size_t>(end_of_column - line.begin()));
+  }
+
+
+  // consecutive lines with the same query
+  auto next_group(std::string_view &buffer) -> std::string_view {
+    auto const query = first_column(buffer);
+    auto remaining {buffer};
+    while (not remaining.empty() and first_column(remaining) == query) {
+      static_cast<void>(next_line(remaining));
     }
+    auto const group = buffer.substr(0, buffer.size() - remaining.size());
+    buffer = remaining;
+    return group;
+  }
+
+
+  // matches of a single query are parsed, visited, and released
+  auto parse_group(std::vector<struct OTU> &OTUs,
+                   struct Identifiers const &identifiers,
+                   struct Parameters const &parameters,
+                   std::vector<bool> &is_seen,
+                   struct Chunk &chunk,
+                   std::string_view const group,
+                   std::function<void(struct OTU &)> const &visit) -> void {
+    auto const query = identifiers.index.find(first_column(group));
+    if (query != identifiers.index.end()) {
+      if (is_seen[query->second]) {
+        fatal("match list is not grouped by query OTU (see 'sort -k1,1'): " +
+              std::string{first_column(group)});
+      }
+      is_seen[query->second] = true;
+    }
+
+    chunk.lines = group;
+    chunk.matches.clear();
+    chunk.unknown_OTUs.clear();
+    parse_chunk(OTUs, identifiers, parameters, chunk);
+    scatter_matches(chunk, [&OTUs](std::vector<struct Match_record> const &matches) {
+      append_matches(OTUs, matches);
+    });
+
+    if (query == identifiers.index.end()) { return; }
+    auto &otu = OTUs[query->second];
+    visit(otu);
+    otu.matches = {};  // release memory
+  }
+
+}  // namespace
+
+
+auto read_match_list(std::vector<struct OTU> &OTUs,
+                     struct Identifiers const &identifiers,
+                     struct Parameters const &parameters) -> void {
+  std::cout << "parse match list... ";
+  read_match_records(OTUs, identifiers, parameters,
+                     [&OTUs](std::vector<struct Match_record> const &matches) {
+                       append_matches(OTUs, matches);
+                     });
   std::cout << "done\n";
 }
+
+
+auto read_match_records(std::vector<struct OTU> const &OTUs,
+                        struct Identifiers const &identifiers,
+                        struct Parameters const &parameters,
+                        Match_sink const &store) -> void {
+  // blocks of lines are parsed in parallel
+  for_each_block(parameters.match_list, [&](std::string_view const block) {
+    parse_block(OTUs, identifiers, parameters, block, store);
+  });
+}
+
+
+auto read_grouped_match_list(std::vector<struct OTU> &OTUs,
+                             struct Identifiers const &identifiers,
+                             struct Parameters const &parameters,
+                             std::function<void(struct OTU &)> const &visit) -> void {
+  // a query OTU can't reappear once its group is complete
+  std::vector<bool> is_seen(OTUs.size(), false);
+  Chunk chunk;  // reused for each group
+  Mapped_file const match_list {parameters.match_list};
+  if (match_list.is_mapped()) {
+    auto buffer {match_list.contents()};
+    while (not buffer.empty()) {
+      parse_group(OTUs, identifiers, parameters, is_seen, chunk, next_group(buffer), visit);
+    }
+    return;
+  }
+
+  // streams can't be mapped: lines of the current group are copied
+  std::ifstream match_list_stream {parameters.match_list};
+  std::string line;
+  std::string group;
+  while (std::getline(match_list_stream, line)) {
+    if (not group.empty() and first_column(line) != first_column(group)) {
+      parse_group(OTUs, identifiers, parameters, is_seen, chunk, group, visit);
+      group.clear();
+    }
+    group.append(line).push_back('\n');
+  }
+  if (not group.empty()) {
+    parse_group(OTUs, identifiers, parameters, is_seen, chunk, group, visit);
+  }
+}
@@ -21,8 +21,26 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
-#include <string>
-#include <unordered_map>
+#include <functional>
+#include <vector>
 
-auto read_match_list (std::unordered_map<std::string, struct OTU> &OTUs,
-                     struct Parameters const &parameters) -> void;
+// accepted matches, in input order
+using Match_sink = std::function<void(std::vector<struct Match_record> const &)>;
+
+auto read_match_list (std::vector<struct OTU> &OTUs,
+                      struct Identifiers const &identifiers,
+                      struct Parameters const &parameters) -> void;
+
+// parse the match list, and pass accepted matches to 'store' (one
+// call per block of lines)
+auto read_match_records(std::vector<struct OTU> const &OTUs,
+                        struct Identifiers const &identifiers,
+                        struct Parameters const &parameters,
+                        Match_sink const &store) -> void;
+
+// match lists grouped by query OTU are read one group at a time: the
+// matches of a query OTU are passed to 'visit', and then released
+auto read_grouped_match_list(std::vector<struct OTU> &OTUs,
+                             struct Identifiers const &identifiers,
+                             struct Parameters const &parameters,
+                             std::function<void(struct OTU &)> const &visit) -> void;
@@ -0,0 +1,519 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::ranges::copy, std::min
+#include <array>
+#include <cassert>
+#include <charconv>  // std::to_chars
+#include <cstddef>  // std::byte, std::size_t
+#include <cstdint>  // std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstring>  // std::memcpy
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>  // std::errc
+#include <thread>
+#include <utility>  // std::move
+#include <vector>
+#include "mumu.hpp"
+#include "log_writer.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+
+namespace {
+
+  constexpr auto buffer_size {std::size_t{1} << 20U};  // 1 MiB
+  constexpr auto max_queued_blocks {std::size_t{8}};
+  // largest double in fixed notation: sign, digits, dot and two decimals
+  constexpr auto max_number_length {
+    std::size_t{std::numeric_limits<double>::max_exponent10 + 1} + 4};
+  constexpr auto precision {2};
+  constexpr std::string_view accept_as_parent {"accepted"};
+  constexpr std::string_view reject_as_parent {"rejected"};
+
+
+  // binary log value types
+  enum class Column_type : std::uint32_t {
+    name_index = 1,  // uint32, index in the table of OTU names
+    uint32 = 2,
+    uint64 = 3,
+    float64 = 4,
+    status = 5  // uint8, 1 if accepted, 0 if rejected
+  };
+
+
+  struct Column {
+    std::string_view name;
+    Column_type type {Column_type::uint64};
+    std::uint32_t width {0};  // bytes per value
+  };
+
+
+  constexpr auto n_columns {18U};
+
+  constexpr std::array<struct Column, n_columns> columns {{
+      {.name="query_id", .type=Column_type::name_index, .width=4},  // 1.  name of query OTU
+      {.name="parent_id", .type=Column_type::name_index, .width=4},  // 2.  name of potential parent OTU
+      {.name="similarity", .type=Column_type::float64, .width=8},  // 3.  percentage of similarity
+      {.name="query_total_abundance", .type=Column_type::uint64, .width=8},  // 4.  total abundance of the query OTU (sum through all samples)
+      {.name="parent_total_abundance", .type=Column_type::uint64, .width=8},  // 5.  total abundance of the potential parent OTU (sum through all samples)
+      {.name="query_overlap_abundance", .type=Column_type::uint64, .width=8},  // 6.  sum through all samples where the potential parent OTU is also present
+      {.name="parent_overlap_abundance", .type=Column_type::uint64, .width=8},  // 7.  sum through all samples where the query OTU is also present
+      {.name="query_incidence", .type=Column_type::uint32, .width=4},  // 8.  number of samples where the query OTU is present
+      {.name="parent_incidence", .type=Column_type::uint32, .width=4},  // 9.  number of samples where the potential parent OTU is present
+      {.name="common_incidence", .type=Column_type::uint32, .width=4},  // 10. number of samples where both the potential parent OTU and the query OTU are present
+      {.name="smallest_ratio", .type=Column_type::float64, .width=8},  // 11. smallest observed abundance ratio
+      {.name="sum_ratio", .type=Column_type::float64, .width=8},  // 12. sum of the abundance ratios
+      {.name="avg_ratio", .type=Column_type::float64, .width=8},  // 13. average value of abundance ratios
+      {.name="smallest_non_null_ratio", .type=Column_type::float64, .width=8},  // 14. smallest non-null abundance ratio
+      {.name="avg_non_null_ratio", .type=Column_type::float64, .width=8},  // 15. average value of non-null abundance ratios
+      {.name="largest_ratio", .type=Column_type::float64, .width=8},  // 16. largest ratio value
+      {.name="relative_incidence", .type=Column_type::float64, .width=8},  // 17. relative incidence (common incidence / query incidence)
+      {.name="status", .type=Column_type::status, .width=1}  // 18. potential parent OTU is either accepted as a parent, or rejected
+    }};
+
+
+  // binary log layout: header, column directory, table of OTU names
+  // (n_names + 1 offsets, then characters), and columns. Values are
+  // in native byte order, sections start at a multiple of 8 bytes
+  constexpr std::array<char, 8> binary_log_magic {'M', 'U', 'M', 'U', 'L', 'O', 'G', '\0'};
+  constexpr std::uint32_t binary_log_version {1};
+  constexpr auto alignment {std::uint64_t{8}};
+  constexpr auto rows_per_chunk {std::size_t{1} << 14U};
+
+  struct Binary_log_header {
+    std::array<char, 8> magic {binary_log_magic};
+    std::uint32_t version {binary_log_version};
+    std::uint32_t n_columns {0};
+    std::uint64_t n_rows {0};
+    std::uint64_t n_names {0};
+    std::uint64_t names_offset {0};  // from the start of the file
+    std::uint64_t names_size {0};  // in bytes
+  };
+
+  struct Binary_log_column {
+    std::array<char, 32> name {};  // null-padded
+    Column_type type {Column_type::uint64};
+    std::uint32_t width {0};
+    std::uint64_t offset {0};  // from the start of the file
+  };
+
+  static_assert(sizeof(Binary_log_header) % alignment == 0);
+  static_assert(sizeof(Binary_log_column) % alignment == 0);
+
+
+  auto align(std::uint64_t const offset) -> std::uint64_t {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+
+  auto print_log_header(std::ofstream& log_file) -> void {
+    for (auto const &column : columns) {
+      log_file << column.name << (column.name == columns.back().name ? '\n' : sepchar);
+    }
+  }
+
+
+  template <typename Value>
+  auto write_value(std::ofstream &output, Value const &value) -> void {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    output.write(reinterpret_cast<char const *>(&value), sizeof(Value));
+  }
+
+
+  auto write_padding(std::ofstream &output, std::uint64_t const size) -> void {
+    static constexpr std::array<char, alignment> zeros {};
+    output.write(zeros.data(), static_cast<std::streamsize>(align(size) - size));
+  }
+
+
+  template <typename Value>
+  auto read_value(std::string_view const file, std::uint64_t const offset) -> Value {
+    Value value {};
+    std::memcpy(&value, &file[offset], sizeof(Value));
+    return value;
+  }
+
+}  // namespace
+
+
+Log_writer::Log_writer(struct Parameters const &parameters,
+                       std::vector<std::string_view> names)
+  : names_ {std::move(names)},
+    log_file_ {parameters.log, std::ios::binary},
+    buffer_(buffer_size),
+    is_binary_ {parameters.log_format == log_format_binary} {
+  if (is_binary_) {
+    temporary_directory_ = get_temporary_directory(parameters);
+    column_buffers_.resize(n_columns);
+    for (auto i {0UL}; i < n_columns; ++i) {
+      column_buffers_[i].resize(rows_per_chunk * columns[i].width);
+    }
+  }
+  else {
+    print_log_header(log_file_);
+  }
+  writer_ = std::jthread {[this] { run(); }};
+}
+
+
+Log_writer::~Log_writer() {
+  {
+    std::lock_guard const lock {mutex_};
+    is_closing_ = true;
+  }
+  is_not_empty_.notify_one();
+  writer_.join();
+}
+
+
+auto Log_writer::write(std::vector<struct Stats> &records) -> void {
+  if (records.empty()) { return; }
+  {
+    std::unique_lock lock {mutex_};
+    is_not_full_.wait(lock, [this] { return queue_.size() < max_queued_blocks; });
+    queue_.push_back(std::move(records));
+    records = {};
+    if (not free_blocks_.empty()) {
+      records = std::move(free_blocks_.back());
+      free_blocks_.pop_back();
+    }
+  }
+  is_not_empty_.notify_one();
+}
+
+
+auto Log_writer::run() -> void {
+  while (true) {
+    std::vector<struct Stats> block;
+    {
+      std::unique_lock lock {mutex_};
+      is_not_empty_.wait(lock, [this] { return is_closing_ or not queue_.empty(); });
+      if (queue_.empty()) { break; }  // closing, all blocks are written
+      block = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    is_not_full_.notify_one();
+
+    for (auto const &stats : block) {
+      if (is_binary_) {
+        store(stats);
+      }
+      else {
+        format(stats);
+      }
+    }
+
+    block.clear();  // keep capacity
+    std::lock_guard const lock {mutex_};
+    if (free_blocks_.size() < max_queued_blocks) {
+      free_blocks_.push_back(std::move(block));
+    }
+  }
+  if (is_binary_) {
+    write_binary_log();
+  }
+  else {
+    flush();
+  }
+}
+
+
+// same output as std::fixed and precision(2) with iostreams
+auto Log_writer::format(struct Stats const &stats) -> void {
+  put_text(names_[stats.child]);
+  put_text(names_[stats.parent]);
+  put_double(stats.similarity);
+  put_integer(stats.child_total_abundance);
+  put_integer(stats.parent_total_abundance);
+  put_integer(stats.child_overlap_abundance);
+  put_integer(stats.parent_overlap_abundance);
+  put_integer(stats.child_spread);
+  put_integer(stats.parent_spread);
+  put_integer(stats.parent_overlap_spread);
+  put_double(stats.smallest_ratio);
+  put_double(stats.sum_ratio);
+  put_double(stats.avg_ratio);
+  put_double(stats.smallest_non_null_ratio);
+  put_double(stats.avg_non_null_ratio);
+  put_double(stats.largest_ratio);
+  put_double(stats.relative_cooccurrence);
+  put_text(stats.is_accepted ? accept_as_parent : reject_as_parent);
+  buffer_[used_ - 1] = '\n';  // replace last separator
+}
+
+
+// make room for 'length' chars
+auto Log_writer::reserve(std::size_t const length) -> void {
+  if (used_ + length <= buffer_.size()) { return; }
+  flush();
+  if (length > buffer_.size()) {
+    buffer_.resize(length);  // very long OTU names
+  }
+}
+
+
+// each value is followed by a separator
+auto Log_writer::put_text(std::string_view const text) -> void {
+  reserve(text.size() + 1);
+  std::ranges::copy(text, &buffer_[used_]);
+  used_ += text.size();
+  buffer_[used_++] = sepchar;
+}
+
+
+auto Log_writer::put_integer(unsigned long int const value) -> void {
+  reserve(max_number_length + 1);
+  auto * const first = &buffer_[used_];
+  [[maybe_unused]] auto const [last, error] = std::to_chars(first, first + max_number_length, value);
+  assert(error == std::errc{});
+  used_ += static_cast<std::size_t>(last - first);
+  buffer_[used_++] = sepchar;
+}
+
+
+auto Log_writer::put_double(double const value) -> void {
+  reserve(max_number_length + 1);
+  auto * const first = &buffer_[used_];
+  [[maybe_unused]] auto const [last, error] = std::to_chars(first, first + max_number_length, value,
+                                                            std::chars_format::fixed, precision);
+  assert(error == std::errc{});
+  used_ += static_cast<std::size_t>(last - first);
+  buffer_[used_++] = sepchar;
+}
+
+
+auto Log_writer::flush() -> void {
+  log_file_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+  used_ = 0;
+}
+
+
+// copy values at the end of column buffers (same order as 'columns')
+auto Log_writer::store(struct Stats const &stats) -> void {
+  auto column {0UL};
+  auto const put = [&](auto const value) {
+    static_assert(std::is_trivially_copyable_v<decltype(value)>);
+    assert(sizeof(value) == columns[column].width);
+    std::memcpy(&column_buffers_[column][n_buffered_rows_ * sizeof(value)], &value, sizeof(value));
+    ++column;
+  };
+  put(stats.child);
+  put(stats.parent);
+  put(stats.similarity);
+  put(std::uint64_t{stats.child_total_abundance});
+  put(std::uint64_t{stats.parent_total_abundance});
+  put(std::uint64_t{stats.child_overlap_abundance});
+  put(std::uint64_t{stats.parent_overlap_abundance});
+  put(std::uint32_t{stats.child_spread});
+  put(std::uint32_t{stats.parent_spread});
+  put(std::uint32_t{stats.parent_overlap_spread});
+  put(stats.smallest_ratio);
+  put(stats.sum_ratio);
+  put(stats.avg_ratio);
+  put(stats.smallest_non_null_ratio);
+  put(stats.avg_non_null_ratio);
+  put(stats.largest_ratio);
+  put(stats.relative_cooccurrence);
+  put(std::uint8_t{stats.is_accepted ? std::uint8_t{1} : std::uint8_t{0}});
+  ++n_buffered_rows_;
+  ++n_rows_;
+  if (n_buffered_rows_ == rows_per_chunk) { spill(); }
+}
+
+
+// append full column buffers to the temporary file, one column after
+// the other
+auto Log_writer::spill() -> void {
+  if (not spill_file_) {
+    spill_file_.emplace(temporary_directory_);
+  }
+  for (auto i {0UL}; i < n_columns; ++i) {
+    spill_file_->append(std::span{column_buffers_[i]}.first(n_buffered_rows_ * columns[i].width));
+  }
+  spilled_rows_.push_back(n_buffered_rows_);
+  n_buffered_rows_ = 0;
+}
+
+
+auto Log_writer::write_binary_log() -> void {
+  // names
+  auto names_size {(names_.size() + 1) * sizeof(std::uint64_t)};
+  for (auto const name : names_) { names_size += name.size(); }
+
+  Binary_log_header header;
+  header.n_columns = n_columns;
+  header.n_rows = n_rows_;
+  header.n_names = names_.size();
+  header.names_offset = sizeof(Binary_log_header) + (n_columns * sizeof(Binary_log_column));
+  header.names_size = names_size;
+  write_value(log_file_, header);
+
+  auto offset {align(header.names_offset + names_size)};
+  for (auto const &column : columns) {
+    Binary_log_column entry;
+    std::ranges::copy(column.name, entry.name.begin());
+    entry.type = column.type;
+    entry.width = column.width;
+    entry.offset = offset;
+    write_value(log_file_, entry);
+    offset = align(offset + (n_rows_ * column.width));
+  }
+
+  auto name_offset {std::uint64_t{0}};
+  for (auto const name : names_) {
+    write_value(log_file_, name_offset);
+    name_offset += name.size();
+  }
+  write_value(log_file_, name_offset);
+  for (auto const name : names_) {
+    log_file_.write(name.data(), static_cast<std::streamsize>(name.size()));
+  }
+  write_padding(log_file_, header.names_offset + names_size);
+
+  for (auto i {0UL}; i < n_columns; ++i) {
+    write_column(i, columns[i].width);
+  }
+}
+
+
+// gather a column: spilled chunks, then buffered values
+auto Log_writer::write_column(std::size_t const column,
+                              std::size_t const width) -> void {
+  auto chunk_start {0UL};
+  for (auto const n_rows : spilled_rows_) {
+    auto offset {chunk_start};
+    for (auto i {0UL}; i < column; ++i) { offset += n_rows * columns[i].width; }
+    auto remaining {n_rows * width};
+    while (remaining != 0) {
+      auto const n_bytes = spill_file_->read(
+          offset, std::as_writable_bytes(std::span{buffer_}).first(std::min(remaining, buffer_.size())));
+      log_file_.write(buffer_.data(), static_cast<std::streamsize>(n_bytes));
+      offset += n_bytes;
+      remaining -= n_bytes;
+    }
+    for (auto i {0UL}; i < n_columns; ++i) { chunk_start += n_rows * columns[i].width; }
+  }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  log_file_.write(reinterpret_cast<char const *>(column_buffers_[column].data()),
+                  static_cast<std::streamsize>(n_buffered_rows_ * width));
+  write_padding(log_file_, n_rows_ * width);
+}
+
+
+auto convert_log_to_tsv(struct Parameters const &parameters) -> void {
+  std::cout << "convert binary log... ";
+  Mapped_file const binary_log {parameters.log_to_tsv};
+  auto const contents {binary_log.contents()};
+  auto const is_invalid = [&](std::uint64_t const offset, std::uint64_t const size) {
+    return offset > contents.size() or size > contents.size() - offset;
+  };
+  auto const not_a_binary_log = [&parameters]() {
+    fatal("not a mumu binary log: " + parameters.log_to_tsv);
+  };
+
+  // header and column directory
+  if (not binary_log.is_mapped() or is_invalid(0, sizeof(Binary_log_header))) {
+    not_a_binary_log();
+  }
+  auto const header {read_value<Binary_log_header>(contents, 0)};
+  if (header.magic != binary_log_magic or header.version != binary_log_version
+      or header.n_columns != n_columns
+      or is_invalid(sizeof(Binary_log_header), n_columns * sizeof(Binary_log_column))) {
+    not_a_binary_log();
+  }
+  std::array<std::uint64_t, n_columns> offsets {};
+  for (auto i {0UL}; i < n_columns; ++i) {
+    auto const entry {read_value<Binary_log_column>(
+        contents, sizeof(Binary_log_header) + (i * sizeof(Binary_log_column)))};
+    if (entry.type != columns[i].type or entry.width != columns[i].width
+        or header.n_rows > contents.size() / entry.width
+        or is_invalid(entry.offset, header.n_rows * entry.width)) {
+      not_a_binary_log();
+    }
+    offsets[i] = entry.offset;
+  }
+
+  // table of OTU names
+  if (header.n_names >= contents.size() / sizeof(std::uint64_t)
+      or is_invalid(header.names_offset, header.names_size)
+      or header.names_size < (header.n_names + 1) * sizeof(std::uint64_t)) {
+    not_a_binary_log();
+  }
+  auto const characters = header.names_offset + ((header.n_names + 1) * sizeof(std::uint64_t));
+  auto const n_characters = header.names_offset + header.names_size - characters;
+  std::vector<std::string_view> names;
+  names.reserve(header.n_names);
+  for (auto i {0UL}; i < header.n_names; ++i) {
+    auto const first {read_value<std::uint64_t>(contents, header.names_offset + (i * sizeof(std::uint64_t)))};
+    auto const last {read_value<std::uint64_t>(contents, header.names_offset + ((i + 1) * sizeof(std::uint64_t)))};
+    if (first > last or last > n_characters) { not_a_binary_log(); }
+    names.push_back(contents.substr(characters + first, last - first));
+  }
+
+  // rows
+  auto tsv_parameters {parameters};
+  tsv_parameters.log_format = log_format_tsv;
+  Log_writer log_writer {tsv_parameters, names};
+  std::vector<struct Stats> records;
+  for (auto row {0UL}; row < header.n_rows; ++row) {
+    auto column {0UL};
+    auto const get = [&]<typename Value>() -> Value {
+      auto const value {read_value<Value>(contents, offsets[column] + (row * sizeof(Value)))};
+      ++column;
+      return value;
+    };
+    Stats stats;
+    stats.child = get.operator()<std::uint32_t>();
+    stats.parent = get.operator()<std::uint32_t>();
+    stats.similarity = get.operator()<double>();
+    stats.child_total_abundance = get.operator()<std::uint64_t>();
+    stats.parent_total_abundance = get.operator()<std::uint64_t>();
+    stats.child_overlap_abundance = get.operator()<std::uint64_t>();
+    stats.parent_overlap_abundance = get.operator()<std::uint64_t>();
+    stats.child_spread = get.operator()<std::uint32_t>();
+    stats.parent_spread = get.operator()<std::uint32_t>();
+    stats.parent_overlap_spread = get.operator()<std::uint32_t>();
+    stats.smallest_ratio = get.operator()<double>();
+    stats.sum_ratio = get.operator()<double>();
+    stats.avg_ratio = get.operator()<double>();
+    stats.smallest_non_null_ratio = get.operator()<double>();
+    stats.avg_non_null_ratio = get.operator()<double>();
+    stats.largest_ratio = get.operator()<double>();
+    stats.relative_cooccurrence = get.operator()<double>();
+    stats.is_accepted = get.operator()<std::uint8_t>() == 1;
+    if (stats.child >= names.size() or stats.parent >= names.size()) {
+      not_a_binary_log();
+    }
+    records.push_back(stats);
+    if (records.size() >= Log_writer::block_size) {
+      log_writer.write(records);
+    }
+  }
+  log_writer.write(records);
+  std::cout << "done, " << header.n_rows << " entries\n";
+}
@@ -0,0 +1,130 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <condition_variable>
+#include <cstddef>  // std::byte, std::size_t
+#include <cstdint>  // std::uint32_t
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "temporary_file.hpp"
+
+
+// statistics of a query OTU and of one of its potential parents (one
+// line of the log file). Records have a fixed size: OTUs are
+// represented by their index
+struct Stats {
+private:
+  static constexpr auto largest_double{std::numeric_limits<double>::max()};
+public:
+  std::uint32_t child {0};
+  std::uint32_t parent {0};
+  double similarity {0.0};
+  unsigned long int child_total_abundance {1};  // refactoring: can't be zero, but zero is clearer?
+  unsigned long int parent_total_abundance {0};  // refactoring: same as above?
+  unsigned long int child_overlap_abundance {0};
+  unsigned long int parent_overlap_abundance {0};
+  unsigned int child_spread {0};
+  unsigned int parent_spread {0};
+  unsigned int parent_overlap_spread {0};
+  bool is_accepted {false};
+  bool padding_1 {false};
+  bool padding_2 {false};
+  bool padding_3 {false};
+  double smallest_ratio {largest_double};
+  double sum_ratio {0.0};
+  double avg_ratio {0.0};
+  double smallest_non_null_ratio {largest_double};
+  double avg_non_null_ratio {0.0};
+  double largest_ratio {0.0};
+  double relative_cooccurrence {0.0};
+};
+
+
+// log records are written by a separate thread. Blocks of records are
+// passed through a bounded queue, and their memory is recycled.
+// Tab-separated lines are formatted into a large reusable buffer.
+// Binary logs store each column contiguously: values are copied into
+// column buffers, spilled to a temporary file when full, and gathered
+// column by column when the log is closed
+class Log_writer {
+public:
+  // number of records worth passing at once
+  static constexpr auto block_size {std::size_t{1024}};
+
+  // OTU names, in OTU index order
+  Log_writer(struct Parameters const &parameters,
+             std::vector<std::string_view> names);
+  ~Log_writer();  // write remaining records
+  Log_writer(Log_writer const &) = delete;
+  Log_writer(Log_writer &&) = delete;
+  auto operator=(Log_writer const &) -> Log_writer & = delete;
+  auto operator=(Log_writer &&) -> Log_writer & = delete;
+
+  // pass records to the writer thread (wait if the queue is full),
+  // 'records' is replaced with an empty block
+  auto write(std::vector<struct Stats> &records) -> void;
+
+private:
+  auto run() -> void;
+  auto format(struct Stats const &stats) -> void;
+  auto reserve(std::size_t length) -> void;
+  auto put_text(std::string_view text) -> void;
+  auto put_integer(unsigned long int value) -> void;
+  auto put_double(double value) -> void;
+  auto flush() -> void;
+  auto store(struct Stats const &stats) -> void;
+  auto spill() -> void;
+  auto write_binary_log() -> void;
+  auto write_column(std::size_t column, std::size_t width) -> void;
+
+  std::vector<std::string_view> names_;
+  std::ofstream log_file_;
+  std::vector<char> buffer_;
+  std::size_t used_ {0};
+  // binary log
+  bool is_binary_ {false};
+  std::string temporary_directory_;
+  std::vector<std::vector<std::byte>> column_buffers_;
+  std::size_t n_buffered_rows_ {0};
+  std::size_t n_rows_ {0};
+  std::vector<std::size_t> spilled_rows_;  // per spilled chunk
+  std::optional<Temporary_file> spill_file_;
+  std::mutex mutex_;
+  std::condition_variable is_not_empty_;
+  std::condition_variable is_not_full_;
+  std::deque<std::vector<struct Stats>> queue_;
+  std::vector<std::vector<struct Stats>> free_blocks_;
+  bool is_closing_ {false};
+  std::jthread writer_;  // last: started when other members are ready
+};
+
+
+// --log_to_tsv: write a binary log as a tab-separated log
+auto convert_log_to_tsv(struct Parameters const &parameters) -> void;
@@ -0,0 +1,117 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <fcntl.h>  // open
+#include <sys/mman.h>  // mmap, madvise, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>  // close, sysconf
+#include <algorithm>  // std::clamp, std::min
+#include <cstddef>  // std::size_t
+#include <cstring>  // std::memchr
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_file.hpp"
+
+
+Mapped_file::Mapped_file(std::string const & file_name) {
+  auto const file_descriptor = open(file_name.c_str(), O_RDONLY);
+  if (file_descriptor == -1) { return; }
+
+  struct stat file_status {};
+  auto const is_regular = fstat(file_descriptor, &file_status) == 0
+    and S_ISREG(file_status.st_mode)
+    and file_status.st_size > 0;
+  if (is_regular) {
+    auto const size = static_cast<std::size_t>(file_status.st_size);
+    auto * const address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+                                file_descriptor, 0);
+    if (address != MAP_FAILED) {
+      // files are scanned once, from start to end
+      static_cast<void>(madvise(address, size, MADV_SEQUENTIAL));
+      data_ = static_cast<char const *>(address);
+      size_ = size;
+    }
+  }
+  close(file_descriptor);  // mapping remains valid
+}
+
+
+Mapped_file::~Mapped_file() {
+  if (data_ == nullptr) { return; }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  munmap(const_cast<char *>(data_), size_);
+}
+
+
+auto Mapped_file::is_mapped() const -> bool {
+  return data_ != nullptr;
+}
+
+
+auto Mapped_file::contents() const -> std::string_view {
+  return {data_, size_};
+}
+
+
+auto Mapped_file::release(std::string_view const part) const -> void {
+  // only whole pages can be released
+  static auto const page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  auto const start = static_cast<std::size_t>(part.data() - data_);
+  auto const first_page = (start + page_size - 1) / page_size * page_size;
+  auto const end_of_part = (start + part.size()) / page_size * page_size;
+  if (end_of_part <= first_page) { return; }
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  static_cast<void>(madvise(const_cast<char *>(data_) + first_page,
+                            end_of_part - first_page, MADV_DONTNEED));
+}
+
+
+auto next_line(std::string_view &buffer) -> std::string_view {
+  auto const * const end_of_line = static_cast<char const *>(
+      std::memchr(buffer.data(), '\n', buffer.size()));
+  auto const length = (end_of_line == nullptr) ?
+    buffer.size() : static_cast<std::size_t>(end_of_line - buffer.data());
+  auto const line = buffer.substr(0, length);
+  buffer.remove_prefix(std::min(length + 1, buffer.size()));
+  return line;
+}
+
+
+auto split_lines(std::string_view const buffer,
+                 unsigned long int const n_threads) -> std::vector<std::string_view> {
+  static constexpr auto minimum_block_size {std::size_t{1} << 20U};  // 1 MiB
+  auto const n_blocks = std::clamp(buffer.size() / minimum_block_size,
+                                   std::size_t{1}, std::size_t{n_threads});
+  std::vector<std::string_view> blocks;
+  blocks.reserve(n_blocks);
+  auto remaining {buffer};
+  for (auto i {n_blocks}; i > 1; --i) {
+    auto const end_of_line = remaining.find('\n', remaining.size() / i);
+    if (end_of_line == std::string_view::npos) { break; }
+    blocks.push_back(remaining.substr(0, end_of_line + 1));
+    remaining.remove_prefix(end_of_line + 1);
+  }
+  blocks.push_back(remaining);
+  return blocks;
+}
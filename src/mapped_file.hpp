@@ -0,0 +1,60 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <cstddef>  // std::size_t
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// read-only memory map of a regular file. Pipes, process
+// substitutions, character devices and empty files can't be mapped:
+// is_mapped() is false and callers must fall back to a stream reader
+class Mapped_file {
+public:
+  explicit Mapped_file(std::string const & file_name);
+  ~Mapped_file();
+  Mapped_file(Mapped_file const &) = delete;
+  Mapped_file(Mapped_file &&) = delete;
+  auto operator=(Mapped_file const &) -> Mapped_file & = delete;
+  auto operator=(Mapped_file &&) -> Mapped_file & = delete;
+
+  [[nodiscard]] auto is_mapped() const -> bool;
+  [[nodiscard]] auto contents() const -> std::string_view;
+  // tell the kernel that this part of the file won't be read again
+  auto release(std::string_view part) const -> void;
+
+private:
+  char const * data_ {nullptr};
+  std::size_t size_ {0};
+};
+
+
+// return the next line (without its end-of-line) and remove it from
+// the buffer
+auto next_line(std::string_view &buffer) -> std::string_view;
+
+// cut the buffer into blocks of complete lines, one per thread; small
+// buffers are not split
+auto split_lines(std::string_view buffer,
+                 unsigned long int n_threads) -> std::vector<std::string_view>;
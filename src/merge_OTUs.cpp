@@ -22,72 +22,196 @@
 // France
 
 #include <algorithm>
-#include <functional>
+#include <atomic>
+#include <cassert>
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
 #include <iostream>
-#include <string>
-#include <unordered_map>
+#include <limits>
+#include <span>
+#include <thread>
+#include <utility>  // std::move
+#include <vector>
 #include "mumu.hpp"
 
 
 namespace {
 
-// find the root of  the merging chain:
-// OTU C can be merged with OTU B, that can merge with OTU A.
-// Hence, OTU C should be merged with OTU A.
+  // find the roots of all merging chains:
+  // OTU C can be merged with OTU B, that can merge with OTU A.
+  // Hence, OTU C should be merged with OTU A.
+  // Each chain is walked once: all the OTUs visited on the way point
+  // directly to the root (path compression), and later walks stop as
+  // soon as they reach an OTU whose root is known
   [[nodiscard]]
-  auto find_root(std::unordered_map<std::string, struct OTU> &OTUs,
-                 std::string root) -> std::string {
-    while (OTUs[root].is_mergeable) {
-      // refactoring: performance: store parent ID in a variable instead of looking up
-      root = {OTUs[root].parent_id};
+  auto find_roots(std::vector<struct OTU> const &OTUs) -> std::vector<std::uint32_t> {
+    static constexpr auto unknown {std::numeric_limits<std::uint32_t>::max()};
+    std::vector<std::uint32_t> roots(OTUs.size(), unknown);
+    std::vector<std::uint32_t> path;
+    for (auto i {0UL}; i < OTUs.size(); ++i) {
+      auto node = static_cast<std::uint32_t>(i);
+      while (roots[node] == unknown and OTUs[node].is_mergeable) {
+        path.push_back(node);
+        node = OTUs[node].parent;
+      }
+      auto const root = (roots[node] == unknown) ? node : roots[node];
+      roots[node] = root;
+      for (auto const visited : path) {
+        roots[visited] = root;
+      }
+      path.clear();
     }
-    return root;
+    return roots;
   }
 
 
-  // auto add_reads_to_root (std::vector<unsigned long int>& child,
-  //                         std::vector<unsigned long int>& root) -> void {
-  //   std::ranges::transform(child.samples,
-  //                          root.samples,
-  //                          root.samples.begin(),
-  //                          std::plus{});
-  // }
-} // namespace
+  auto add_sparse_reads_to_root(struct OTU const &child,
+                                struct OTU &root) -> void {
+    // merge two lists of (sample index, abundance), sorted by sample index
+    std::vector<unsigned long int> samples;
+    std::vector<unsigned int> columns;
+    samples.reserve(root.columns.size() + child.columns.size());
+    columns.reserve(root.columns.size() + child.columns.size());
+    auto i {0UL};
+    auto j {0UL};
+    while (i < root.columns.size() or j < child.columns.size()) {
+      auto const from_root = j == child.columns.size() or
+        (i < root.columns.size() and root.columns[i] <= child.columns[j]);
+      auto const from_child = i == root.columns.size() or
+        (j < child.columns.size() and child.columns[j] <= root.columns[i]);
+      columns.push_back(from_root ? root.columns[i] : child.columns[j]);
+      samples.push_back((from_root ? root.samples[i++] : 0UL) +
+                        (from_child ? child.samples[j++] : 0UL));
+    }
+    samples.shrink_to_fit();
+    columns.shrink_to_fit();
+    root.samples = std::move(samples);
+    root.columns = std::move(columns);
+  }
 
 
-auto merge_OTUs(std::unordered_map<std::string, struct OTU> &OTUs) -> void {
-  std::cout << "merge OTUs... ";
-  for (auto const& otu : OTUs) {
-    auto const & OTU_id {otu.first};
-    // skip orphans
-    if (not OTUs[OTU_id].is_mergeable) { continue; }
-    // find the end of the merging chain
-    const auto root = find_root(OTUs, OTUs[OTU_id].parent_id);
-    // add child's reads to root's reads
-    // refactoring: add_reads_to_root(OTUs[OTU_id], OTUs[root]);
-    std::ranges::transform(OTUs[OTU_id].samples,
-                           OTUs[root].samples,
-                           OTUs[root].samples.begin(),
-                           std::plus{});
-    // update status
-    OTUs[OTU_id].is_merged = true;
-    OTUs[root].is_root = true;
-    OTUs[root].sum_reads += OTUs[OTU_id].sum_reads;
+  // add a block of child's samples to the root's samples (unsigned
+  // additions wrap around, like std::plus). The loop is vectorized by
+  // the compiler, and is bound by memory bandwidth
+  auto add_samples(std::span<unsigned long int const> const child,
+                   std::span<unsigned long int> const root) -> void {
+    for (auto i {0UL}; i < root.size(); ++i) {
+      root[i] += child[i];
+    }
   }
-  std::cout << "done\n";
-}
 
 
-auto update_spread_values(std::unordered_map<std::string, struct OTU> &OTUs) -> void {
-  std::cout << "update spread values... ";
-  for (auto const& otu : OTUs) {
-    auto const& OTU_id {otu.first};
-    // skip unmodified OTUs
-    if (not OTUs[OTU_id].is_root) { continue; }
-
-    // refactor: move to a new file count_occurrences
+  auto count_samples_with_reads(std::span<unsigned long int const> const samples) -> unsigned int {
+    // (sparse storage: abundance values can only be null after an overflow)
     auto has_reads = [](const auto n_reads) -> bool { return n_reads != 0; };
-    OTUs[OTU_id].spread = static_cast<unsigned int>(std::ranges::count_if(OTUs[OTU_id].samples, has_reads));
+    return static_cast<unsigned int>(std::ranges::count_if(samples, has_reads));
+  }
+
+
+  // add the reads of all the children of a dense root. Samples are
+  // visited in blocks: a block of the root stays in cache while
+  // children are added, and is then scanned to count samples with
+  // reads (root's spread). Low-incidence children only add the
+  // samples where they are present
+  auto add_dense_reads_to_root(std::vector<struct OTU> const &OTUs,
+                               std::span<std::uint32_t const> const children,
+                               struct OTU &root) -> void {
+    static constexpr auto block_size {std::size_t{512}};  // 4 KiB
+    for (auto const index : children) {
+      auto const & child = OTUs[index];
+      if (child.columns.empty()) { continue; }
+      for (auto i {0UL}; i < child.columns.size(); ++i) {
+        root.samples[child.columns[i]] += child.samples[child.columns[i]];
+      }
+    }
+    auto const n_samples {root.samples.size()};
+    auto spread {0U};
+    for (auto first {0UL}; first < n_samples; first += block_size) {
+      auto const length {std::min(block_size, n_samples - first)};
+      auto const root_block {std::span{root.samples}.subspan(first, length)};
+      for (auto const index : children) {
+        auto const & child = OTUs[index];
+        if (not child.columns.empty()) { continue; }
+        add_samples(std::span{child.samples}.subspan(first, length), root_block);
+      }
+      spread += count_samples_with_reads(root_block);
+    }
+    root.spread = spread;
+  }
+
+
+  // a root and its children: children only belong to one root, tasks
+  // are independent
+  auto merge_children(std::vector<struct OTU> &OTUs,
+                      std::uint32_t const root_index,
+                      std::span<std::uint32_t const> const children) -> void {
+    auto & root = OTUs[root_index];
+    if (root.is_sparse) {
+      for (auto const index : children) {
+        assert(OTUs[index].is_sparse);
+        add_sparse_reads_to_root(OTUs[index], root);
+      }
+      root.spread = count_samples_with_reads(root.samples);
+    }
+    else {
+      add_dense_reads_to_root(OTUs, children, root);
+    }
+    for (auto const index : children) {
+      auto & child = OTUs[index];
+      child.is_merged = true;
+      root.sum_reads += child.sum_reads;
+    }
+    root.is_root = true;
+  }
+} // namespace
+
+
+auto merge_OTUs(std::vector<struct OTU> &OTUs,
+                unsigned long int const n_threads) -> void {
+  std::cout << "merge OTUs... ";
+  auto const roots {find_roots(OTUs)};
+
+  // group children by root (counting sort, in input order)
+  std::vector<std::size_t> first_child(OTUs.size() + 1, 0);
+  for (auto i {0UL}; i < OTUs.size(); ++i) {
+    if (OTUs[i].is_mergeable) { ++first_child[roots[i] + 1]; }
+  }
+  std::vector<std::uint32_t> merge_roots;
+  for (auto i {0UL}; i < OTUs.size(); ++i) {
+    if (first_child[i + 1] != 0) { merge_roots.push_back(static_cast<std::uint32_t>(i)); }
+    first_child[i + 1] += first_child[i];
+  }
+  std::vector<std::uint32_t> children(first_child.back());
+  {
+    auto next_child {first_child};
+    for (auto i {0UL}; i < OTUs.size(); ++i) {
+      if (OTUs[i].is_mergeable) {
+        children[next_child[roots[i]]++] = static_cast<std::uint32_t>(i);
+      }
+    }
+  }
+
+  // one root at a time, distributed to threads on demand
+  std::atomic<std::size_t> next_root {0};
+  auto const worker = [&]() -> void {
+    while (true) {
+      auto const i = next_root.fetch_add(1, std::memory_order_relaxed);
+      if (i >= merge_roots.size()) { return; }
+      auto const root {merge_roots[i]};
+      merge_children(OTUs, root,
+                     std::span{children}.subspan(first_child[root],
+                                                 first_child[root + 1] - first_child[root]));
+    }
+  };
+  if (n_threads == 1) {
+    worker();
+  }
+  else {
+    std::vector<std::jthread> workers;
+    workers.reserve(n_threads);
+    for (auto i {0UL}; i < n_threads; ++i) {
+      workers.emplace_back(worker);
+    }
   }
   std::cout << "done\n";
 }
@@ -21,9 +21,9 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
-#include <string>
-#include <unordered_map>
+#include <vector>
 
-auto merge_OTUs (std::unordered_map<std::string, struct OTU> &OTUs) -> void;
-
-auto update_spread_values (std::unordered_map<std::string, struct OTU> &OTUs) -> void;
+// add the reads of merged OTUs to their root OTU, and update the
+// spread of root OTUs (one root per task, in parallel)
+auto merge_OTUs (std::vector<struct OTU> &OTUs,
+                 unsigned long int n_threads) -> void;
@@ -24,16 +24,17 @@
 #include <cstdlib>  // EXIT_SUCCESS
 #include <ios>
 #include <iostream>
-#include <string>
-#include <unordered_map>
+#include <vector>
 #include "mumu.hpp"
 #include "cli.hpp"
 #include "validate_args.hpp"
 #include "load_OTUs.hpp"
+#include "log_writer.hpp"
 #include "load_matches.hpp"
 #include "search_parent.hpp"
 #include "sort_matches.hpp"
 #include "merge_OTUs.hpp"
+#include "sweep.hpp"
 #include "write_table.hpp"
 
 
@@ -46,20 +47,37 @@ auto main (int argc, char** argv) -> int {
   Parameters parameters;
   parse_args(argc, argv, parameters);
   validate_args(parameters);
+  if (parameters.is_log_to_tsv) {
+    convert_log_to_tsv(parameters);
+    return EXIT_SUCCESS;
+  }
+  if (parameters.is_sweep) {
+    // load once, one new OTU table per parameter set
+    sweep(parameters);
+    return EXIT_SUCCESS;
+  }
 
   // load and index data
-  std::unordered_map<std::string, struct OTU> OTUs;
-  read_otu_table(OTUs, parameters);
-  read_match_list(OTUs, parameters);
-  sort_matches(OTUs, parameters);
-
-  // find potential parents (could be multithreaded)
-  search_parent(OTUs, parameters);
+  std::vector<struct OTU> OTUs;
+  Identifiers identifiers;
+  auto const n_samples {read_otu_table(OTUs, identifiers, parameters)};
+  if (parameters.is_grouped_match_list or parameters.memory_budget != 0) {
+    // one query OTU at a time: find potential parents
+    search_parent(OTUs, identifiers, parameters);
+    identifiers.index = {};
+  }
+  else {
+    read_match_list(OTUs, identifiers, parameters);
+    identifiers.index = {};  // IDs are not searched after that point
+    heapify_matches(OTUs, parameters);
+
+    // find potential parents (multithreaded)
+    search_parent(OTUs, parameters);
+  }
 
   // merge, sort and output
-  merge_OTUs(OTUs);
-  update_spread_values(OTUs);
-  write_table(OTUs, parameters.new_otu_table);
+  merge_OTUs(OTUs, parameters.threads);
+  write_table(OTUs, n_samples, parameters.new_otu_table, parameters.threads);
 
   return EXIT_SUCCESS;
 }
@@ -69,7 +87,6 @@ auto main (int argc, char** argv) -> int {
 
 // - const parameters = parse_args(argc, argv) -> Parameters
 // - don't close input files when testing (allow mumu to use named pipes) (not a priority)
-// - use 'sort(par_unseq' to get parallel and/or vectorized sort,
 // - use async() to test potential parents? not cluster-friendly, no
 //   control on CPU/thread usage
 // - benchmark 'const auto& sample' or 'const auto sample' to print out OTUs,
@@ -44,6 +44,11 @@ constexpr auto minimum_relative_cooccurrence_default {0.95};
 constexpr auto minimum_ratio_default {1.0};
 constexpr std::string_view use_minimum_value {"min"};
 constexpr std::string_view use_average_value {"avg"};
+constexpr std::string_view log_level_full {"full"};
+constexpr std::string_view log_level_accepted {"accepted"};
+constexpr std::string_view log_level_none {"none"};
+constexpr std::string_view log_format_tsv {"tsv"};
+constexpr std::string_view log_format_binary {"binary"};
 
 
 struct Parameters {
@@ -53,13 +58,24 @@ struct Parameters {
   bool is_new_otu_table {false};
   bool is_log {false};
   bool is_legacy {false};  // not mandatory
-  bool padding_6 {false};
-  bool padding_7 {false};
-  bool padding_8 {false};
+  bool is_grouped_match_list {false};  // not mandatory
+  bool is_log_to_tsv {false};  // conversion mode
+  bool is_parent_major {false};  // not mandatory
+  bool is_sweep {false};  // not mandatory
+  bool is_pair_cache {false};  // not mandatory
+  bool is_memory_budget {false};  // not mandatory
+  bool padding_12 {false};
+  bool padding_13 {false};
+  bool padding_14 {false};
+  bool padding_15 {false};
+  bool padding_16 {false};
   std::string otu_table;
   std::string match_list;
   std::string new_otu_table;
   std::string log;
+  std::string log_to_tsv;  // binary log to convert
+  std::string sweep;  // parameter sets
+  std::string pair_cache;
 
   // default values
   unsigned long int threads {threads_default};
@@ -67,39 +83,64 @@ struct Parameters {
   double minimum_ratio {minimum_ratio_default};
   double minimum_relative_cooccurrence {minimum_relative_cooccurrence_default};
   std::string_view minimum_ratio_type {use_minimum_value};
+  std::string_view log_level {log_level_full};
+  std::string_view log_format {log_format_tsv};
+  unsigned long int memory_budget {0};  // in MiB, zero is unlimited
+  std::string temporary_directory;
 };
 
 
+// sort keys (abundance, spread, name) are read from the hit OTU, and
+// summarized by its rank in the potential parent order.
+// Similarity values are not converted to float: a float can't
+// reproduce the rounding of all input values in the log file
 struct Match {
   double similarity {0.0};
-  unsigned long int hit_sum_reads {0};
-  unsigned long int hit_spread {0};
-  unsigned long int hit_input_order {0};
-  std::string hit_id;  // refactor: replace with string_view?
-
-  auto operator<=>(Match const& rhs) const {
-    // order by similarity,
-    // if equal, order by abundance,
-    // if equal, order by spread,
-    // if equal, lexicographic order (A, B, ..., a, b, c, ...)
-    return
-      std::tie(similarity, hit_sum_reads, hit_spread, rhs.hit_id) <=>
-      std::tie(rhs.similarity, rhs.hit_sum_reads, rhs.hit_spread, hit_id);
-  }
-
-  auto operator==(Match const& rhs) const -> bool = default;
+  std::uint32_t hit {0};  // index of the hit OTU
+  std::uint32_t rank {0};  // rank of the hit OTU (see heapify_matches())
 };
 
+static_assert(sizeof(Match) == 16, "Match should be as small as possible");
 
+
+// a match and the index of its query OTU (match list parsing,
+// temporary files)
+struct Match_record {
+  double similarity {0.0};
+  std::uint32_t query {0};
+  std::uint32_t hit {0};
+};
+
+static_assert(sizeof(Match_record) == 16, "Match_record should be as small as possible");
+
+
+// abundance values are stored either for all samples (dense), or
+// only for samples with reads (sparse, 'columns' holds the sample
+// index of each value). The storage mode is the same for all OTUs,
+// and is chosen when loading the OTU table. Dense OTUs also record
+// which samples have reads, to quickly find samples shared by two
+// OTUs, and dense OTUs present in few samples keep their list of
+// columns (not updated when merging OTUs).
 struct OTU {
   std::vector<struct Match> matches;
   std::vector<unsigned long int> samples;
-  std::string parent_id;  // std::string_view? no
-  unsigned long int input_order {0};
+  std::vector<unsigned int> columns;  // sparse storage, or low-incidence dense OTUs
+  std::vector<std::uint64_t> presence;  // dense storage only, one bit per sample
+  std::string_view id;  // points into Identifiers::arena
   unsigned long int sum_reads {0};
+  std::uint32_t parent {0};  // index of the parent OTU (if mergeable)
   unsigned int spread {0};
   bool is_mergeable {false};
   bool is_merged {false};
   bool is_root {false};
-  bool padding_8 {false};
+  bool is_sparse {false};
+};
+
+
+// OTUs are stored in input order, their position is their index.
+// OTU identifiers are interned: stored back to back in a single
+// string, and translated into indices when parsing input files.
+struct Identifiers {
+  std::string arena;
+  std::unordered_map<std::string_view, std::uint32_t> index;  // parsing only
 };
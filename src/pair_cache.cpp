@@ -0,0 +1,346 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::max, std::ranges::sort, std::ranges::unique
+#include <array>
+#include <cassert>
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t, std::uint64_t
+#include <cstring>  // std::memcpy
+#include <filesystem>
+#include <fstream>
+#include <functional>  // std::greater
+#include <ios>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>  // std::error_code
+#include <utility>  // std::pair
+#include <vector>
+#include "mumu.hpp"
+#include "pair_cache.hpp"
+#include "mapped_file.hpp"
+#include "ratios.hpp"
+#include "temporary_file.hpp"
+#include "utils.hpp"
+
+
+namespace {
+
+  constexpr std::array<char, 8> pair_cache_magic {'M', 'U', 'M', 'U', 'P', 'A', 'I', 'R'};
+  constexpr std::uint32_t pair_cache_version {1};
+
+  struct Header {
+    std::array<char, 8> magic {pair_cache_magic};
+    std::uint32_t version {pair_cache_version};
+    std::uint32_t record_size {sizeof(Pair_cache::Record)};
+    std::uint64_t otu_table_checksum {0};
+    std::uint64_t match_list_checksum {0};
+    std::uint64_t n_records {0};
+  };
+
+  using Record = Pair_cache::Record;
+
+  static_assert(sizeof(Record) == 64, "Record should be as small as possible");
+  static_assert(sizeof(Header) % alignof(Record) == 0);
+
+
+  // new pairs kept in memory: --memory_budget, or 64 MiB
+  auto get_max_new_records(struct Parameters const &parameters) -> std::size_t {
+    static constexpr auto mebibyte {std::size_t{1} << 20U};
+    static constexpr auto default_budget {std::size_t{64}};  // in MiB
+    auto const budget = parameters.is_memory_budget ? parameters.memory_budget : default_budget;
+    return std::max(budget * mebibyte / sizeof(Record), std::size_t{1});
+  }
+
+
+  auto get_key(std::uint32_t const child, std::uint32_t const parent) -> std::uint64_t {
+    static constexpr auto half {32U};
+    return (std::uint64_t{child} << half) | parent;
+  }
+
+
+  // fast 64-bit hash of a whole file (not cryptographic: files are
+  // only compared with their previous version)
+  auto get_checksum(std::string const &file_name) -> std::optional<std::uint64_t> {
+    static constexpr auto multiplier {std::uint64_t{0x9E3779B97F4A7C15}};
+    static constexpr auto shift {29U};
+    Mapped_file const input_file {file_name};
+    if (not input_file.is_mapped()) { return std::nullopt; }
+    auto const contents {input_file.contents()};
+    auto hash {contents.size() * multiplier};
+    auto const mix = [&hash](std::uint64_t const word) {
+      hash = (hash ^ word) * multiplier;
+      hash ^= hash >> shift;
+    };
+    auto const n_words {contents.size() / sizeof(std::uint64_t)};
+    for (auto i {0UL}; i < n_words; ++i) {
+      std::uint64_t word {0};
+      std::memcpy(&word, &contents[i * sizeof(std::uint64_t)], sizeof(std::uint64_t));
+      mix(word);
+    }
+    std::uint64_t last_word {0};
+    std::memcpy(&last_word, contents.data() + (n_words * sizeof(std::uint64_t)),
+                contents.size() - (n_words * sizeof(std::uint64_t)));
+    mix(last_word);
+    return hash;
+  }
+
+
+  template <typename Value>
+  auto write_value(std::ofstream &output, Value const &value) -> void {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    output.write(reinterpret_cast<char const *>(&value), sizeof(Value));
+  }
+
+
+  // sort by key, and remove repeated pairs (repeated matches)
+  auto sort_records(std::vector<Record> &records) -> void {
+    auto const by_key = [](Record const &record) { return record.key; };
+    std::ranges::sort(records, {}, by_key);
+    auto const duplicates {std::ranges::unique(records, {}, by_key)};
+    records.erase(duplicates.begin(), duplicates.end());
+  }
+
+
+  // buffered sequential reader of a sorted run (without a run, the
+  // buffer holds all the records)
+  struct Run_reader {
+    Temporary_file const *run {nullptr};
+    std::vector<Record> buffer;
+    std::size_t next {0};  // in buffer
+    std::size_t offset {0};  // in run, in bytes
+
+    auto refill() -> void {
+      buffer.resize(run == nullptr ? 0 : buffer.capacity());
+      if (run != nullptr) {
+        auto const n_bytes = run->read(offset, std::as_writable_bytes(std::span{buffer}));
+        buffer.resize(n_bytes / sizeof(Record));
+        offset += n_bytes;
+      }
+      next = 0;
+    }
+
+    [[nodiscard]] auto is_done() const -> bool { return next == buffer.size(); }
+
+    auto pop() -> Record {
+      auto const record = buffer[next];
+      ++next;
+      if (is_done()) { refill(); }
+      return record;
+    }
+  };
+
+
+  // k-way merge of sorted runs, by increasing key
+  template <typename Function>
+  auto merge_runs(std::vector<Run_reader> &readers, Function output) -> void {
+    using Head = std::pair<std::uint64_t, std::size_t>;  // key, reader
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for (auto i {0UL}; i < readers.size(); ++i) {
+      if (not readers[i].is_done()) { heads.emplace(readers[i].buffer.front().key, i); }
+    }
+    while (not heads.empty()) {
+      auto const index = heads.top().second;
+      heads.pop();
+      auto &reader = readers[index];
+      output(reader.pop());
+      if (not reader.is_done()) { heads.emplace(reader.buffer[reader.next].key, index); }
+    }
+  }
+}  // namespace
+
+
+Pair_cache::Pair_cache(struct Parameters const &parameters)
+  : file_name_ {parameters.pair_cache},
+    temporary_directory_ {get_temporary_directory(parameters)},
+    max_new_records_ {get_max_new_records(parameters)} {
+  if (not parameters.is_pair_cache) { return; }
+  auto const otu_table_checksum {get_checksum(parameters.otu_table)};
+  auto const match_list_checksum {get_checksum(parameters.match_list)};
+  if (not otu_table_checksum or not match_list_checksum) {
+    warn("--pair_cache needs regular input files, pair statistics are not cached");
+    return;
+  }
+  is_enabled_ = true;
+  otu_table_checksum_ = *otu_table_checksum;
+  match_list_checksum_ = *match_list_checksum;
+
+  // reuse the cache file if it was made from the same input files
+  is_outdated_ = true;
+  cache_file_ = std::make_unique<Mapped_file const>(file_name_);
+  auto const contents {cache_file_->contents()};
+  if (not cache_file_->is_mapped() or contents.size() < sizeof(Header)) { return; }
+  Header header;
+  std::memcpy(&header, contents.data(), sizeof(Header));
+  auto const is_valid = header.magic == pair_cache_magic
+    and header.version == pair_cache_version
+    and header.record_size == sizeof(Record)
+    and header.otu_table_checksum == otu_table_checksum_
+    and header.match_list_checksum == match_list_checksum_
+    and header.n_records == (contents.size() - sizeof(Header)) / sizeof(Record)
+    and (contents.size() - sizeof(Header)) % sizeof(Record) == 0;
+  if (not is_valid) { return; }
+  is_outdated_ = false;
+  n_records_ = header.n_records;
+}
+
+
+Pair_cache::~Pair_cache() = default;
+
+
+auto Pair_cache::is_enabled() const -> bool {
+  return is_enabled_;
+}
+
+
+auto Pair_cache::get_record(std::size_t const index) const -> Record {
+  Record record;
+  std::memcpy(&record, cache_file_->contents().data() + sizeof(Header) + (index * sizeof(Record)),
+              sizeof(Record));
+  return record;
+}
+
+
+auto Pair_cache::find(std::uint32_t const child,
+                      std::uint32_t const parent) const -> std::optional<struct Ratios> {
+  if (n_records_ == 0) { return std::nullopt; }
+  // binary search
+  auto const key {get_key(child, parent)};
+  auto first {0UL};
+  auto count {n_records_};
+  while (count > 0) {
+    auto const step {count / 2};
+    if (get_record(first + step).key < key) {
+      first += step + 1;
+      count -= step + 1;
+    }
+    else {
+      count = step;
+    }
+  }
+  if (first == n_records_) { return std::nullopt; }
+  auto const record {get_record(first)};
+  if (record.key != key) { return std::nullopt; }
+  return Ratios {.child_overlap_abundance = record.child_overlap_abundance,
+                 .parent_overlap_abundance = record.parent_overlap_abundance,
+                 .parent_overlap_spread = record.parent_overlap_spread,
+                 .smallest_ratio = record.smallest_ratio,
+                 .sum_ratio = record.sum_ratio,
+                 .smallest_non_null_ratio = record.smallest_non_null_ratio,
+                 .largest_ratio = record.largest_ratio};
+}
+
+
+auto Pair_cache::insert(std::uint32_t const child,
+                        std::uint32_t const parent,
+                        struct Ratios const &ratios) -> void {
+  assert(not ratios.is_rejected);  // incomplete ratios
+  std::lock_guard const lock {mutex_};
+  new_records_.push_back({.key = get_key(child, parent),
+                          .child_overlap_abundance = ratios.child_overlap_abundance,
+                          .parent_overlap_abundance = ratios.parent_overlap_abundance,
+                          .smallest_ratio = ratios.smallest_ratio,
+                          .sum_ratio = ratios.sum_ratio,
+                          .smallest_non_null_ratio = ratios.smallest_non_null_ratio,
+                          .largest_ratio = ratios.largest_ratio,
+                          .parent_overlap_spread = ratios.parent_overlap_spread});
+  if (new_records_.size() >= max_new_records_) { spill(); }
+}
+
+
+// sort new records, and write them to a new run
+auto Pair_cache::spill() -> void {
+  sort_records(new_records_);
+  runs_.push_back(std::make_unique<Temporary_file>(temporary_directory_));
+  runs_.back()->append(std::as_bytes(std::span{new_records_}));
+  new_records_.clear();
+}
+
+
+// merge cached and new records (runs, and records still in memory)
+// into a new file, that then replaces the cache file (the old file
+// remains mapped until then)
+auto Pair_cache::save() -> void {
+  if (not is_enabled_ or
+      (new_records_.empty() and runs_.empty() and not is_outdated_)) { return; }
+  std::cout << "save pair statistics... ";
+  static constexpr auto buffer_size {std::size_t{1} << 12U};  // in records
+  sort_records(new_records_);
+  std::vector<Run_reader> readers(runs_.size() + 1);
+  for (auto i {0UL}; i < runs_.size(); ++i) {
+    readers[i].run = runs_[i].get();
+    readers[i].buffer.reserve(buffer_size);
+    readers[i].refill();
+  }
+  readers.back().buffer = std::move(new_records_);
+
+  auto const new_file_name {file_name_ + ".tmp"};
+  auto n_new_records {0UL};
+  {
+    std::ofstream cache {new_file_name, std::ios::binary};
+    if (not cache) {
+      fatal("can't open output file " + new_file_name);
+    }
+    write_value(cache, Header {});  // number of records is not known yet
+    auto i {0UL};
+    auto previous_key {std::uint64_t{0}};
+    merge_runs(readers, [&](Record const &new_record) {
+      // repeated matches in different runs
+      if (n_new_records != 0 and new_record.key == previous_key) { return; }
+      for (; i < n_records_ and get_record(i).key < new_record.key; ++i) {
+        write_value(cache, get_record(i));
+      }
+      write_value(cache, new_record);
+      previous_key = new_record.key;
+      ++n_new_records;
+    });
+    for (; i < n_records_; ++i) {
+      write_value(cache, get_record(i));
+    }
+    cache.seekp(0);
+    write_value(cache, Header {.otu_table_checksum = otu_table_checksum_,
+                               .match_list_checksum = match_list_checksum_,
+                               .n_records = n_records_ + n_new_records});
+    if (not cache) {
+      fatal("can't write to file " + new_file_name);
+    }
+  }
+  runs_.clear();  // release temporary files
+
+  std::error_code error;
+  std::filesystem::rename(new_file_name, file_name_, error);
+  if (error) {
+    auto const reason {error.message()};
+    std::filesystem::remove(new_file_name, error);
+    fatal("can't replace pair cache file " + file_name_ + " (" + reason + ")");
+  }
+  std::cout << "done, " << n_records_ + n_new_records << " pairs ("
+            << n_new_records << " new)\n";
+}
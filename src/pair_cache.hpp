@@ -0,0 +1,98 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t, std::uint64_t
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+class Mapped_file;
+class Temporary_file;
+
+
+// --pair_cache: statistics of pairs of OTUs (overlaps and ratios) are
+// saved from one run to the next. They only depend on the abundance
+// values of the two OTUs, not on thresholds: a cache file is reused
+// as long as the OTU table and the match list are unchanged (same
+// checksums). Pairs missing from the cache are computed and added.
+// New pairs are kept in memory up to a limit (--memory_budget, or 64
+// MiB), and then written to sorted runs in temporary files
+class Pair_cache {
+public:
+  explicit Pair_cache(struct Parameters const &parameters);
+  ~Pair_cache();
+  Pair_cache(Pair_cache const &) = delete;
+  Pair_cache(Pair_cache &&) = delete;
+  auto operator=(Pair_cache const &) -> Pair_cache & = delete;
+  auto operator=(Pair_cache &&) -> Pair_cache & = delete;
+
+  [[nodiscard]] auto is_enabled() const -> bool;
+  [[nodiscard]] auto find(std::uint32_t child,
+                          std::uint32_t parent) const -> std::optional<struct Ratios>;
+  // thread-safe (may write a run)
+  auto insert(std::uint32_t child,
+              std::uint32_t parent,
+              struct Ratios const &ratios) -> void;
+  // write cached and new pairs (if there are new pairs)
+  auto save() -> void;
+
+  // one pair of OTUs (complete ratios only)
+  struct Record {
+    std::uint64_t key {0};  // child and parent indices
+    std::uint64_t child_overlap_abundance {0};
+    std::uint64_t parent_overlap_abundance {0};
+    double smallest_ratio {0.0};
+    double sum_ratio {0.0};
+    double smallest_non_null_ratio {0.0};
+    double largest_ratio {0.0};
+    std::uint32_t parent_overlap_spread {0};
+    std::uint32_t padding {0};
+  };
+
+private:
+  [[nodiscard]] auto get_record(std::size_t index) const -> Record;
+  auto spill() -> void;
+
+  std::string file_name_;
+  std::uint64_t otu_table_checksum_ {0};
+  std::uint64_t match_list_checksum_ {0};
+  std::unique_ptr<Mapped_file const> cache_file_;
+  std::string temporary_directory_;
+  std::size_t n_records_ {0};  // in the cache file, sorted by key
+  std::size_t max_new_records_ {0};
+  std::vector<Record> new_records_;
+  std::vector<std::unique_ptr<Temporary_file>> runs_;  // sorted by key
+  std::mutex mutex_;
+  bool is_enabled_ {false};
+  bool is_outdated_ {false};  // missing or invalid cache file
+  bool padding_1 {false};
+  bool padding_2 {false};
+  bool padding_3 {false};
+  bool padding_4 {false};
+  bool padding_5 {false};
+  bool padding_6 {false};
+};
@@ -0,0 +1,90 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::clamp, std::copy, std::merge, std::sort
+#include <cstddef>  // std::ptrdiff_t, std::size_t
+#include <thread>
+#include <vector>
+
+
+// sort blocks in parallel, then merge pairs of blocks in parallel
+// rounds; small vectors are sorted in place by the calling thread.
+// The comparison must be a strict total order (no equivalent values),
+// so that the result does not depend on the number of threads
+template <typename T, typename Compare>
+auto parallel_sort(std::vector<T> &values,
+                   Compare const compare,
+                   unsigned long int const n_threads) -> void {
+  static constexpr auto minimum_block_size {std::size_t{1} << 14U};
+  auto const n_blocks = std::clamp(values.size() / minimum_block_size,
+                                   std::size_t{1}, std::size_t{n_threads});
+  if (n_blocks == 1) {
+    std::ranges::sort(values, compare);
+    return;
+  }
+
+  std::vector<std::size_t> boundaries;
+  boundaries.reserve(n_blocks + 1);
+  for (auto i {0UL}; i <= n_blocks; ++i) {
+    boundaries.push_back(values.size() * i / n_blocks);
+  }
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(n_blocks);
+    for (auto i {0UL}; i < n_blocks; ++i) {
+      workers.emplace_back([&values, &boundaries, compare, i]() -> void {
+        std::sort(values.begin() + static_cast<std::ptrdiff_t>(boundaries[i]),
+                  values.begin() + static_cast<std::ptrdiff_t>(boundaries[i + 1]),
+                  compare);
+      });
+    }
+  }
+
+  // merge neighbour blocks, back and forth between the two buffers
+  std::vector<T> buffer(values.size());
+  auto const at = [](std::vector<T> &vector, std::size_t const position) {
+    return vector.begin() + static_cast<std::ptrdiff_t>(position);
+  };
+  while (boundaries.size() > 2) {
+    std::vector<std::size_t> merged_boundaries;
+    merged_boundaries.reserve((boundaries.size() / 2) + 1);
+    {
+      std::vector<std::jthread> workers;
+      for (auto i {0UL}; i + 1 < boundaries.size(); i += 2) {
+        merged_boundaries.push_back(boundaries[i]);
+        if (i + 2 == boundaries.size()) {  // odd block out
+          std::copy(at(values, boundaries[i]), values.end(), at(buffer, boundaries[i]));
+          continue;
+        }
+        workers.emplace_back([&, i]() -> void {
+          std::merge(at(values, boundaries[i]), at(values, boundaries[i + 1]),
+                     at(values, boundaries[i + 1]), at(values, boundaries[i + 2]),
+                     at(buffer, boundaries[i]), compare);
+        });
+      }
+    }
+    merged_boundaries.push_back(values.size());
+    boundaries.swap(merged_boundaries);
+    values.swap(buffer);
+  }
+}
@@ -0,0 +1,461 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+
+#include <algorithm>  // std::min, std::max
+#include <array>
+#include <bit>  // std::countr_zero, std::popcount
+#include <cassert>
+#include <cmath>  // std::fabs
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::int64_t, std::uint64_t
+#include <limits>
+#include <span>
+#include "mumu.hpp"
+#include "ratios.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+// To be bit-identical with the scalar computation, vectorized kernels
+// must:
+// - convert 64-bit integers to doubles with the same rounding,
+// - add ratios one after the other, in sample order (floating-point
+//   addition is not associative). Adding 0.0 (samples without the
+//   child OTU) does not change the sum.
+// Divisions, min and max are exact, and can be computed in any order.
+
+
+namespace {
+
+  // kernels add samples to 'ratios', so that samples can be visited
+  // in several steps
+  using Kernel = auto (*)(std::span<unsigned long int const>,
+                          std::span<unsigned long int const>,
+                          struct Ratios &) -> void;
+
+
+  // one sample at a time (also used for the last few samples)
+  auto add_sample(unsigned long int const child_abundance,
+                  unsigned long int const parent_abundance,
+                  struct Ratios &ratios) -> void {
+    // C++23 refactor: std::pow(2, std::numeric_limits<double>::digits)
+    [[maybe_unused]] static constexpr auto largest_int_without_precision_loss {9'007'199'254'740'992};
+    assert(parent_abundance <= largest_int_without_precision_loss);
+    if (child_abundance == 0) { return; }  // skip this sample
+    if (parent_abundance != 0) {
+      ratios.child_overlap_abundance += child_abundance;
+    }
+    auto const ratio { static_cast<double>(parent_abundance) / static_cast<double>(child_abundance) };
+    ratios.smallest_ratio = std::min(ratio, ratios.smallest_ratio);
+    ratios.largest_ratio = std::max(ratio, ratios.largest_ratio);
+    if (ratio > 0.0) {
+      ratios.smallest_non_null_ratio = std::min(ratio, ratios.smallest_non_null_ratio);
+    }
+    ratios.sum_ratio += ratio;
+    if (parent_abundance != 0) {
+      ++ratios.parent_overlap_spread;
+      ratios.parent_overlap_abundance += parent_abundance;
+    }
+  }
+
+
+  auto dense_ratios_scalar(std::span<unsigned long int const> const child,
+                           std::span<unsigned long int const> const parent,
+                           struct Ratios &ratios) -> void {
+    for (auto i {0UL}; i < child.size(); ++i) {
+      add_sample(child[i], parent[i], ratios);
+    }
+  }
+
+
+#if defined(__x86_64__)
+
+  // exact conversion of four unsigned 64-bit integers (no AVX2
+  // instruction): high and low halves are inserted into the mantissas
+  // of 2^84 and 2^52, the final addition is correctly rounded
+  __attribute__((target("avx2")))
+  auto to_double(__m256i const values) -> __m256d {
+    static constexpr auto two_52 {0x4330'0000'0000'0000LL};
+    static constexpr auto two_84 {0x4530'0000'0000'0000LL};
+    static constexpr auto two_84_52 {19'342'813'118'337'666'422'669'312.0};  // 2^84 + 2^52
+    static constexpr auto low_halves {0b0101'0101};
+    auto const low = _mm256_blend_epi32(_mm256_set1_epi64x(two_52), values, low_halves);
+    auto const high = _mm256_xor_si256(_mm256_srli_epi64(values, 32),
+                                       _mm256_set1_epi64x(two_84));
+    auto const high_minus_offset = _mm256_sub_pd(_mm256_castsi256_pd(high),
+                                                 _mm256_set1_pd(two_84_52));
+    return _mm256_add_pd(high_minus_offset, _mm256_castsi256_pd(low));
+  }
+
+
+  __attribute__((target("avx2")))
+  auto dense_ratios_avx2(std::span<unsigned long int const> const child,
+                         std::span<unsigned long int const> const parent,
+                         struct Ratios &ratios) -> void {
+    static constexpr auto lanes {std::size_t{4}};
+    auto const zero = _mm256_setzero_si256();
+    auto const one = _mm256_set1_epi64x(1);
+    auto const largest = _mm256_set1_pd(std::numeric_limits<double>::max());
+    auto child_overlap = zero;
+    auto parent_overlap = zero;
+    auto overlap_spread = zero;
+    auto smallest = largest;
+    auto smallest_non_null = largest;
+    auto largest_ratio = _mm256_setzero_pd();
+    std::array<double, lanes> sample_ratios {};
+
+    auto i {std::size_t{0}};
+    for (; i + lanes <= child.size(); i += lanes) {
+      // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+      auto const child_values = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&child[i]));
+      auto const parent_values = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&parent[i]));
+      // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+      auto const is_child_absent = _mm256_cmpeq_epi64(child_values, zero);
+      auto const is_parent_absent = _mm256_cmpeq_epi64(parent_values, zero);
+      auto const is_shared = _mm256_andnot_si256(
+          _mm256_or_si256(is_child_absent, is_parent_absent), _mm256_set1_epi64x(-1));
+
+      // absent child: divide by one, and mask the result
+      auto const divisors = _mm256_blendv_epi8(child_values, one, is_child_absent);
+      auto const ratio_values = _mm256_andnot_pd(
+          _mm256_castsi256_pd(is_child_absent),
+          _mm256_div_pd(to_double(parent_values), to_double(divisors)));
+
+      child_overlap = _mm256_add_epi64(child_overlap,
+                                       _mm256_andnot_si256(is_parent_absent, child_values));
+      parent_overlap = _mm256_add_epi64(parent_overlap,
+                                        _mm256_and_si256(is_shared, parent_values));
+      overlap_spread = _mm256_sub_epi64(overlap_spread, is_shared);  // -1 when shared
+      smallest = _mm256_min_pd(smallest, _mm256_blendv_pd(ratio_values, largest,
+                                                           _mm256_castsi256_pd(is_child_absent)));
+      smallest_non_null = _mm256_min_pd(smallest_non_null,
+                                        _mm256_blendv_pd(largest, ratio_values,
+                                                         _mm256_castsi256_pd(is_shared)));
+      largest_ratio = _mm256_max_pd(largest_ratio, ratio_values);
+
+      _mm256_storeu_pd(sample_ratios.data(), ratio_values);
+      for (auto const ratio : sample_ratios) {
+        ratios.sum_ratio += ratio;
+      }
+    }
+
+    // horizontal reductions
+    std::array<std::int64_t, lanes> integers {};
+    std::array<double, lanes> doubles {};
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(integers.data()), child_overlap);
+    for (auto const value : integers) { ratios.child_overlap_abundance += static_cast<unsigned long int>(value); }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(integers.data()), parent_overlap);
+    for (auto const value : integers) { ratios.parent_overlap_abundance += static_cast<unsigned long int>(value); }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(integers.data()), overlap_spread);
+    for (auto const value : integers) { ratios.parent_overlap_spread += static_cast<unsigned int>(value); }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    _mm256_storeu_pd(doubles.data(), smallest);
+    for (auto const value : doubles) { ratios.smallest_ratio = std::min(value, ratios.smallest_ratio); }
+    _mm256_storeu_pd(doubles.data(), smallest_non_null);
+    for (auto const value : doubles) { ratios.smallest_non_null_ratio = std::min(value, ratios.smallest_non_null_ratio); }
+    _mm256_storeu_pd(doubles.data(), largest_ratio);
+    for (auto const value : doubles) { ratios.largest_ratio = std::max(value, ratios.largest_ratio); }
+
+    for (; i < child.size(); ++i) {
+      add_sample(child[i], parent[i], ratios);
+    }
+  }
+
+
+  __attribute__((target("avx512f,avx512dq")))
+  auto dense_ratios_avx512(std::span<unsigned long int const> const child,
+                           std::span<unsigned long int const> const parent,
+                           struct Ratios &ratios) -> void {
+    static constexpr auto lanes {std::size_t{8}};
+    auto const zero = _mm512_setzero_si512();
+    auto const largest = _mm512_set1_pd(std::numeric_limits<double>::max());
+    auto child_overlap = zero;
+    auto parent_overlap = zero;
+    auto overlap_spread {0U};
+    auto smallest = largest;
+    auto smallest_non_null = largest;
+    auto largest_ratio = _mm512_setzero_pd();
+    std::array<double, lanes> sample_ratios {};
+
+    auto i {std::size_t{0}};
+    for (; i + lanes <= child.size(); i += lanes) {
+      auto const child_values = _mm512_loadu_si512(&child[i]);
+      auto const parent_values = _mm512_loadu_si512(&parent[i]);
+      auto const is_child_present = _mm512_test_epi64_mask(child_values, child_values);
+      auto const is_parent_present = _mm512_test_epi64_mask(parent_values, parent_values);
+      auto const is_shared = static_cast<__mmask8>(is_child_present & is_parent_present);
+
+      // absent child: ratio is zero (no division)
+      auto const ratio_values = _mm512_maskz_div_pd(is_child_present,
+                                                    _mm512_cvtepu64_pd(parent_values),
+                                                    _mm512_cvtepu64_pd(child_values));
+
+      child_overlap = _mm512_mask_add_epi64(child_overlap, is_parent_present,
+                                            child_overlap, child_values);
+      parent_overlap = _mm512_mask_add_epi64(parent_overlap, is_shared,
+                                             parent_overlap, parent_values);
+      overlap_spread += static_cast<unsigned int>(__builtin_popcount(is_shared));
+      smallest = _mm512_mask_min_pd(smallest, is_child_present, smallest, ratio_values);
+      smallest_non_null = _mm512_mask_min_pd(smallest_non_null, is_shared,
+                                             smallest_non_null, ratio_values);
+      largest_ratio = _mm512_mask_max_pd(largest_ratio, is_child_present,
+                                         largest_ratio, ratio_values);
+
+      _mm512_storeu_pd(sample_ratios.data(), ratio_values);
+      for (auto const ratio : sample_ratios) {
+        ratios.sum_ratio += ratio;
+      }
+    }
+
+    // horizontal reductions (_mm512_reduce_* and unmasked
+    // intrinsics trigger false uninitialized warnings with GCC 12)
+    std::array<std::int64_t, lanes> integers {};
+    std::array<double, lanes> doubles {};
+    _mm512_storeu_si512(integers.data(), child_overlap);
+    for (auto const value : integers) { ratios.child_overlap_abundance += static_cast<unsigned long int>(value); }
+    _mm512_storeu_si512(integers.data(), parent_overlap);
+    for (auto const value : integers) { ratios.parent_overlap_abundance += static_cast<unsigned long int>(value); }
+    ratios.parent_overlap_spread += overlap_spread;
+    _mm512_storeu_pd(doubles.data(), smallest);
+    for (auto const value : doubles) { ratios.smallest_ratio = std::min(value, ratios.smallest_ratio); }
+    _mm512_storeu_pd(doubles.data(), smallest_non_null);
+    for (auto const value : doubles) { ratios.smallest_non_null_ratio = std::min(value, ratios.smallest_non_null_ratio); }
+    _mm512_storeu_pd(doubles.data(), largest_ratio);
+    for (auto const value : doubles) { ratios.largest_ratio = std::max(value, ratios.largest_ratio); }
+
+    for (; i < child.size(); ++i) {
+      add_sample(child[i], parent[i], ratios);
+    }
+  }
+
+#endif
+
+
+  // only samples present in both OTUs contribute to sums (other
+  // samples add zero), to the largest ratio and to the smallest
+  // non-null ratio. The smallest ratio is zero if the child OTU is
+  // present in other samples.
+  auto shared_ratios(struct OTU const &child,
+                     struct OTU const &parent,
+                     unsigned int const n_shared,
+                     struct Rejection const &rejection) -> struct Ratios {
+    static constexpr auto bits_per_word {64UL};
+    struct Ratios ratios;
+    for (auto word {0UL}; word < child.presence.size(); ++word) {
+      auto shared = child.presence[word] & parent.presence[word];
+      while (shared != 0) {
+        auto const sample = (word * bits_per_word) + static_cast<unsigned long int>(std::countr_zero(shared));
+        shared &= shared - 1;  // clear lowest bit
+        add_sample(child.samples[sample], parent.samples[sample], ratios);
+        if (rejection.is_early_exit and is_rejected(ratios, n_shared, child.spread, rejection)) {
+          ratios.is_rejected = true;
+          return ratios;
+        }
+      }
+    }
+    if (child.spread > ratios.parent_overlap_spread) {
+      ratios.smallest_ratio = 0.0;
+    }
+    return ratios;
+  }
+
+
+  // visit samples where the child OTU is present, parent values are
+  // gathered from these positions
+  auto gathered_ratios(struct OTU const &child,
+                       struct OTU const &parent,
+                       struct Rejection const &rejection) -> struct Ratios {
+    struct Ratios ratios;
+    auto n_remaining {static_cast<unsigned int>(child.columns.size())};
+    for (auto const column : child.columns) {
+      add_sample(child.samples[column], parent.samples[column], ratios);
+      --n_remaining;
+      if (rejection.is_early_exit and
+          is_rejected(ratios, ratios.parent_overlap_spread + n_remaining,
+                      child.spread, rejection)) {
+        ratios.is_rejected = true;
+        return ratios;
+      }
+    }
+    return ratios;
+  }
+
+
+  // vectorized pass, one block of samples at a time, and stop as soon
+  // as rejection is certain
+  auto blockwise_ratios(Kernel const kernel,
+                        struct OTU const &child,
+                        struct OTU const &parent,
+                        unsigned int const n_shared,
+                        struct Rejection const &rejection) -> struct Ratios {
+    static constexpr auto block_size {std::size_t{256}};
+    std::span<unsigned long int const> const child_samples {child.samples};
+    std::span<unsigned long int const> const parent_samples {parent.samples};
+    struct Ratios ratios;
+    for (auto start {std::size_t{0}}; start < child_samples.size(); start += block_size) {
+      auto const length = std::min(block_size, child_samples.size() - start);
+      kernel(child_samples.subspan(start, length),
+             parent_samples.subspan(start, length), ratios);
+      if (is_rejected(ratios, n_shared, child.spread, rejection)) {
+        ratios.is_rejected = true;
+        return ratios;
+      }
+    }
+    return ratios;
+  }
+
+
+  // visiting a single sample costs more than a vectorized pass over
+  // a sample
+  constexpr auto sample_visit_cost {4UL};
+
+
+  using Counter = auto (*)(std::span<std::uint64_t const>,
+                           std::span<std::uint64_t const>) -> unsigned int;
+
+
+  auto count_shared_samples(std::span<std::uint64_t const> const child_presence,
+                            std::span<std::uint64_t const> const parent_presence) -> unsigned int {
+    auto n_shared {0U};
+    for (auto word {0UL}; word < child_presence.size(); ++word) {
+      n_shared += static_cast<unsigned int>(
+          std::popcount(child_presence[word] & parent_presence[word]));
+    }
+    return n_shared;
+  }
+
+
+#if defined(__x86_64__)
+  // same code, compiled with the popcnt instruction
+  __attribute__((target("popcnt")))
+  auto count_shared_samples_popcnt(std::span<std::uint64_t const> const child_presence,
+                                   std::span<std::uint64_t const> const parent_presence) -> unsigned int {
+    auto n_shared {0U};
+    for (auto word {0UL}; word < child_presence.size(); ++word) {
+      n_shared += static_cast<unsigned int>(
+          std::popcount(child_presence[word] & parent_presence[word]));
+    }
+    return n_shared;
+  }
+#endif
+
+
+  auto select_counter() -> Counter {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("popcnt")) {
+      return count_shared_samples_popcnt;
+    }
+#endif
+    return count_shared_samples;
+  }
+
+
+  auto select_kernel() -> Kernel {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512dq")) {
+      return dense_ratios_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return dense_ratios_avx2;
+    }
+#endif
+    return dense_ratios_scalar;
+  }
+
+}  // namespace
+
+
+auto is_null(double const a_ratio) -> bool {
+  // assume that per-sample ratio is never < 1 / 10^17 (epsilon double == 2.22045e-16)
+  return std::fabs(a_ratio) < std::numeric_limits<double>::epsilon();
+}
+
+
+auto is_rejected(struct Ratios const &ratios,
+                 unsigned int const overlap_bound,
+                 unsigned int const child_spread,
+                 struct Rejection const &rejection) -> bool {
+  // no overlap with the potential parent
+  if (overlap_bound == 0) { return true; }
+  // replicate lulu's behavior (no partial overlap)
+  if (rejection.is_legacy and
+      (overlap_bound < child_spread or is_null(ratios.smallest_ratio))) {
+    return true;
+  }
+  // incidence ratio with the potential parent is too low
+  if (1.0 * overlap_bound / child_spread < rejection.minimum_relative_cooccurrence) {
+    return true;
+  }
+  // abundance ratio is too low (smallest values can only decrease)
+  return rejection.is_minimum_ratio and
+    ratios.smallest_non_null_ratio <= rejection.minimum_ratio;
+}
+
+
+auto dense_ratios(std::span<unsigned long int const> const child,
+                  std::span<unsigned long int const> const parent) -> struct Ratios {
+  assert(child.size() == parent.size());
+  static auto const kernel {select_kernel()};
+  struct Ratios ratios;
+  kernel(child, parent, ratios);
+  return ratios;
+}
+
+
+auto dense_ratios(struct OTU const &child,
+                  struct OTU const &parent,
+                  struct Rejection const &rejection) -> struct Ratios {
+  assert(child.presence.size() == parent.presence.size());
+  if (not child.columns.empty()) {
+    return gathered_ratios(child, parent, rejection);
+  }
+  static auto const counter {select_counter()};
+  auto const n_shared {counter(child.presence, parent.presence)};
+  if (rejection.is_early_exit and
+      is_rejected(Ratios{}, n_shared, child.spread, rejection)) {
+    struct Ratios ratios;
+    ratios.is_rejected = true;
+    return ratios;
+  }
+  if (n_shared * sample_visit_cost < child.samples.size()) {
+    return shared_ratios(child, parent, n_shared, rejection);
+  }
+  // only the smallest non-null ratio can stop a full pass
+  if (rejection.is_early_exit and rejection.is_minimum_ratio) {
+    static auto const kernel {select_kernel()};
+    return blockwise_ratios(kernel, child, parent, n_shared, rejection);
+  }
+  return dense_ratios(child.samples, parent.samples);
+}
+
+
+auto is_low_incidence(unsigned int const spread,
+                      std::size_t const n_samples) -> bool {
+  return spread * sample_visit_cost < n_samples;
+}
@@ -0,0 +1,91 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+
+#include <cstddef>  // std::size_t
+#include <cstdint>
+#include <limits>
+#include <span>
+
+
+// abundance ratios of a potential parent OTU and a child OTU, for
+// samples where the child OTU is present
+struct Ratios {
+  unsigned long int child_overlap_abundance {0};
+  unsigned long int parent_overlap_abundance {0};
+  unsigned int parent_overlap_spread {0};
+  bool is_rejected {false};  // stopped early, other values are incomplete
+  bool padding_1 {false};
+  bool padding_2 {false};
+  bool padding_3 {false};
+  double smallest_ratio {std::numeric_limits<double>::max()};
+  double sum_ratio {0.0};
+  double smallest_non_null_ratio {std::numeric_limits<double>::max()};
+  double largest_ratio {0.0};
+};
+
+
+// criteria used to reject a potential parent OTU. When statistics of
+// rejected potential parents are not logged, computations stop as
+// soon as rejection is certain
+struct Rejection {
+  double minimum_relative_cooccurrence {0.0};
+  double minimum_ratio {0.0};
+  bool is_early_exit {false};
+  bool is_minimum_ratio {false};  // "min" ratio type, not "avg"
+  bool is_legacy {false};  // partial overlaps are rejected
+  bool padding_1 {false};
+  bool padding_2 {false};
+  bool padding_3 {false};
+  bool padding_4 {false};
+  bool padding_5 {false};
+};
+
+
+auto is_null(double a_ratio) -> bool;
+
+// is the potential parent rejected, whatever the values of samples
+// not visited yet? 'overlap_bound' is the largest possible number of
+// samples where both OTUs are present
+auto is_rejected(struct Ratios const &ratios,
+                 unsigned int overlap_bound,
+                 unsigned int child_spread,
+                 struct Rejection const &rejection) -> bool;
+
+// dense OTUs (one value per sample). Vectorized if the CPU supports
+// AVX2 or AVX-512, results are identical to the scalar computation
+auto dense_ratios(std::span<unsigned long int const> child,
+                  std::span<unsigned long int const> parent) -> struct Ratios;
+
+// same, using the bit sets of samples where each OTU is present, and
+// the list of samples where the child OTU is present (low-incidence
+// OTUs only). When the list is available, only these samples are
+// visited. Otherwise, samples shared by the two OTUs are found first,
+// and when there are few of them, only these samples are visited
+auto dense_ratios(struct OTU const &child,
+                  struct OTU const &parent,
+                  struct Rejection const &rejection) -> struct Ratios;
+
+// is it faster to visit the samples where an OTU is present, rather
+// than all samples?
+auto is_low_incidence(unsigned int spread, std::size_t n_samples) -> bool;
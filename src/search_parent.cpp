@@ -22,105 +22,90 @@
 // France
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <cmath>  // std::fabs
-#include <fstream>
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
 #include <iostream>
-#include <limits>
-#include <string>
-#include <unordered_map>
+#include <numeric>  // std::iota
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
 #include "mumu.hpp"
+#include "external_sort.hpp"
+#include "load_matches.hpp"
+#include "log_writer.hpp"
+#include "pair_cache.hpp"
+#include "ratios.hpp"
+#include "sort_matches.hpp"
 
 
 namespace {
 
-  constexpr auto accept_as_parent {"accepted"};  // reduce scope
-
-  // refactoring: move to a separate header file stats.h
-  struct Stats {
-  private:
-    static constexpr auto largest_double{std::numeric_limits<double>::max()};
-    static constexpr auto reject_as_parent {"rejected"};
-  public:
-    std::string child_id;  //refactoring: string_view
-    std::string parent_id;
-    double similarity {0.0};
-    unsigned long int child_total_abundance {1};  // refactoring: can't be zero, but zero is clearer?
-    unsigned long int parent_total_abundance {0};  // refactoring: same as above?
-    unsigned long int child_overlap_abundance {0};
-    unsigned long int parent_overlap_abundance {0};
-    unsigned int child_spread {0};
-    unsigned int parent_spread {0};
-    unsigned int parent_overlap_spread {0};
-    unsigned int padding {0};
-    double smallest_ratio {largest_double};
-    double sum_ratio {0.0};
-    double avg_ratio {0.0};
-    double smallest_non_null_ratio {largest_double};
-    double avg_non_null_ratio {0.0};
-    double largest_ratio {0.0};
-    double relative_cooccurrence {0.0};
-    std::string status {reject_as_parent};
-  };
-
-
-  auto operator<<(std::ostream& output_stream, const Stats& stats) -> std::ostream& {
-    output_stream.precision(2);
-    return output_stream
-      << std::fixed
-      << stats.child_id << sepchar
-      << stats.parent_id << sepchar
-      << stats.similarity << sepchar
-      << stats.child_total_abundance << sepchar
-      << stats.parent_total_abundance << sepchar
-      << stats.child_overlap_abundance << sepchar
-      << stats.parent_overlap_abundance << sepchar
-      << stats.child_spread << sepchar
-      << stats.parent_spread << sepchar
-      << stats.parent_overlap_spread << sepchar
-      << stats.smallest_ratio << sepchar
-      << stats.sum_ratio << sepchar
-      << stats.avg_ratio << sepchar
-      << stats.smallest_non_null_ratio << sepchar
-      << stats.avg_non_null_ratio << sepchar
-      << stats.largest_ratio << sepchar
-      << stats.relative_cooccurrence << sepchar
-      << stats.status << '\n';
+  // visit samples where the child OTU has reads, in sample order, and
+  // pass child and parent abundance values to 'visit' (returns false
+  // to stop)
+  template <typename Function>
+  auto for_each_child_sample(OTU const &child,
+                             OTU const &parent,
+                             Function visit) -> void {
+    auto parent_value = [&parent, next = std::size_t{0}](std::size_t const column) mutable
+      -> unsigned long int {
+      if (not parent.is_sparse) { return parent.samples[column]; }
+      // sparse: columns are visited in increasing order
+      while (next < parent.columns.size() and parent.columns[next] < column) { ++next; }
+      if (next == parent.columns.size() or parent.columns[next] != column) { return 0; }
+      return parent.samples[next];
+    };
+
+    if (child.is_sparse) {
+      for (auto i {0UL}; i < child.columns.size(); ++i) {
+        if (not visit(child.samples[i], parent_value(child.columns[i]))) { return; }
+      }
+      return;
+    }
+    for (auto column {0UL}; column < child.samples.size(); ++column) {
+      auto const child_abundance = child.samples[column];
+      if (child_abundance == 0) { continue; }  // skip this sample
+      if (not visit(child_abundance, parent_value(column))) { return; }
+    }
   }
 
 
-  auto print_log_header(std::ofstream& log_file) -> void {
-    log_file
-      << "query_id" << sepchar // 1.  name of query OTU
-      << "parent_id" << sepchar // 2.  name of potential parent OTU
-      << "similarity" << sepchar // 3.  percentage of similarity
-      << "query_total_abundance" << sepchar  // 4.  total abundance of the query OTU (sum through all samples)
-      << "parent_total_abundance" << sepchar  // 5.  total abundance of the potential parent OTU (sum through all samples)
-      << "query_overlap_abundance" << sepchar  // 6.  sum through all samples where the potential parent OTU is also present
-      << "parent_overlap_abundance" << sepchar  // 7.  sum through all samples where the query OTU is also present
-      << "query_incidence" << sepchar  // 8.  number of samples where the query OTU is present
-      << "parent_incidence" << sepchar  // 9.  number of samples where the potential parent OTU is present
-      << "common_incidence" << sepchar  // 10. number of samples where both the potential parent OTU and the query OTU are present
-      << "smallest_ratio" << sepchar  // 11. smallest observed abundance ratio
-      << "sum_ratio" << sepchar  // 12. sum of the abundance ratios
-      << "avg_ratio" << sepchar  // 13. average value of abundance ratios
-      << "smallest_non_null_ratio" << sepchar  // 14. smallest non-null abundance ratio
-      << "avg_non_null_ratio" << sepchar  // 15. average value of non-null abundance ratios
-      << "largest_ratio" << sepchar  // 16. largest ratio value
-      << "relative_incidence" << sepchar  // 17. relative incidence (common incidence / query incidence)
-      << "status"  // 18. potential parent OTU is either accepted as a parent, or rejected
-      << "\n";
+  auto set_ratios(Stats &stats, Ratios const &ratios) -> void {
+    stats.child_overlap_abundance = ratios.child_overlap_abundance;
+    stats.parent_overlap_abundance = ratios.parent_overlap_abundance;
+    stats.parent_overlap_spread = ratios.parent_overlap_spread;
+    stats.smallest_ratio = ratios.smallest_ratio;
+    stats.sum_ratio = ratios.sum_ratio;
+    stats.smallest_non_null_ratio = ratios.smallest_non_null_ratio;
+    stats.largest_ratio = ratios.largest_ratio;
   }
 
 
-  auto is_null(double const a_ratio) -> bool {
-    // assume that per-sample ratio is never < 1 / 10^17 (epsilon double == 2.22045e-16)
-    return std::fabs(a_ratio) < std::numeric_limits<double>::epsilon();
+  auto get_ratios(Stats const &stats) -> Ratios {
+    return {.child_overlap_abundance = stats.child_overlap_abundance,
+            .parent_overlap_abundance = stats.parent_overlap_abundance,
+            .parent_overlap_spread = stats.parent_overlap_spread,
+            .smallest_ratio = stats.smallest_ratio,
+            .sum_ratio = stats.sum_ratio,
+            .smallest_non_null_ratio = stats.smallest_non_null_ratio,
+            .largest_ratio = stats.largest_ratio};
   }
 
 
-  auto per_sample_ratios(std::unordered_map<std::string, struct OTU> &OTUs,
-                         Stats &stats) -> void {
+  // return true if computations stopped early (rejected parent)
+  auto per_sample_ratios(OTU const &child,
+                         OTU const &parent,
+                         Rejection const &rejection,
+                         Stats &stats) -> bool {
+    if (not child.is_sparse and not parent.is_sparse) {
+      auto const ratios {dense_ratios(child, parent, rejection)};
+      set_ratios(stats, ratios);
+      return ratios.is_rejected;
+    }
+
     // C++23 refactor: std::pow(2, std::numeric_limits<double>::digits)
     [[maybe_unused]] static constexpr auto largest_int_without_precision_loss {9'007'199'254'740'992};
 
@@ -128,14 +113,10 @@ namespace {
     // for (std::pair<const &int, const &int> pair: std::views::zip(parent, child)) // available in c++23
 
     // assert(v1.length() == v2.length())
-    auto const& child = OTUs[stats.child_id].samples;
-    auto const& parent = OTUs[stats.parent_id].samples;
-    auto current_child_sample = child.begin();
-    auto current_parent_sample = parent.begin();
-    while (current_child_sample != child.end()) {  // check only one end, vectors have the same length
-      auto child_abundance = *current_child_sample++;
-      const auto& parent_abundance = *current_parent_sample++;
-      if (child_abundance == 0) { continue; }  // skip this sample
+    auto is_stopped {false};
+    auto n_remaining {child.spread};
+    for_each_child_sample(child, parent, [&](unsigned long int const child_abundance,
+                                             unsigned long int const parent_abundance) -> bool {
       assert(parent_abundance <= largest_int_without_precision_loss);
       if (parent_abundance != 0) {
         stats.child_overlap_abundance += child_abundance;
@@ -151,102 +132,439 @@ namespace {
         ++stats.parent_overlap_spread;
         stats.parent_overlap_abundance += parent_abundance;
       }
+      --n_remaining;
+      if (not rejection.is_early_exit) { return true; }
+      Ratios const ratios {.parent_overlap_spread = stats.parent_overlap_spread,
+                           .smallest_ratio = stats.smallest_ratio,
+                           .smallest_non_null_ratio = stats.smallest_non_null_ratio};
+      is_stopped = is_rejected(ratios, stats.parent_overlap_spread + n_remaining,
+                               child.spread, rejection);
+      return not is_stopped;
+    });
+    return is_stopped;
+  }
+
+
+  // same, with --pair_cache: cached ratios are reused, and new ratios
+  // are computed completely, so that they can be cached
+  auto pair_ratios(OTU const &child,
+                   OTU const &parent,
+                   Rejection const &rejection,
+                   Pair_cache &pair_cache,
+                   Stats &stats) -> bool {
+    if (not pair_cache.is_enabled()) {
+      return per_sample_ratios(child, parent, rejection, stats);
+    }
+    if (auto const ratios {pair_cache.find(stats.child, stats.parent)}) {
+      set_ratios(stats, *ratios);
+      return false;
+    }
+    per_sample_ratios(child, parent, Rejection{}, stats);
+    pair_cache.insert(stats.child, stats.parent, get_ratios(stats));
+    return false;
+  }
+
+
+  auto get_rejection(Parameters const &parameters) -> Rejection {
+    // statistics of rejected potential parents are only needed for
+    // the full log
+    return {.minimum_relative_cooccurrence = parameters.minimum_relative_cooccurrence,
+            .minimum_ratio = parameters.minimum_ratio,
+            .is_early_exit = parameters.log_level != log_level_full,
+            .is_minimum_ratio = parameters.minimum_ratio_type == use_minimum_value,
+            .is_legacy = parameters.is_legacy};
+  }
+
+
+  // statistics that do not depend on thresholds (ratios are complete)
+  auto complete_stats(Stats &stats,
+                      Parameters const &parameters) -> void {
+    // no overlap with the potential parent
+    if (stats.parent_overlap_spread == 0) {
+      stats.smallest_ratio = 0.0;
+      stats.smallest_non_null_ratio = 0.0;
+      return;
+    }
+
+    // lulu: partial overlaps are rejected before computing averages
+    if (parameters.is_legacy and is_null(stats.smallest_ratio)) { return; }
+
+    // populate overlap stats
+    stats.avg_ratio = stats.sum_ratio / stats.child_spread;
+    stats.avg_non_null_ratio = stats.sum_ratio / stats.parent_overlap_spread;
+    stats.relative_cooccurrence = 1.0 * stats.parent_overlap_spread / stats.child_spread;
+  }
+
+
+  auto is_accepted(Stats const &stats,
+                   Parameters const &parameters) -> bool {
+    // reject: no overlap with the potential parent
+    if (stats.parent_overlap_spread == 0) { return false; }
+
+    // reject: replicate lulu's behavior (no partial overlap)
+    if (parameters.is_legacy and is_null(stats.smallest_ratio)) { return false; }
+
+    // reject: incidence ratio with the potential parent is too low
+    if (stats.relative_cooccurrence < parameters.minimum_relative_cooccurrence) {
+      return false;
     }
+
+    // reject: abundance ratio with the potential parent is too low
+    return not ((parameters.minimum_ratio_type == use_minimum_value and
+                 stats.smallest_non_null_ratio <= parameters.minimum_ratio)
+                or (parameters.minimum_ratio_type == use_average_value and
+                    stats.avg_non_null_ratio <= parameters.minimum_ratio));
   }
 
 
-  auto test_parents(std::unordered_map<std::string, struct OTU> &OTUs,
+  // return true if the potential parent is accepted
+  auto test_parent(std::vector<struct OTU> const &OTUs,
+                   OTU &otu,
+                   Match const &match,
+                   Parameters const &parameters,
+                   Rejection const &rejection,
+                   Pair_cache &pair_cache,
+                   std::vector<struct Stats> &log_records) -> bool {
+    auto const reject = [&](Stats const &stats) -> bool {
+      if (not rejection.is_early_exit) { log_records.push_back(stats); }
+      return false;
+    };
+
+    auto const& parent = OTUs[match.hit];
+    Stats stats {.child = static_cast<std::uint32_t>(&otu - OTUs.data()),
+                 .parent = match.hit,
+                 .similarity = match.similarity,
+                 .child_total_abundance = otu.sum_reads,
+                 .parent_total_abundance = parent.sum_reads,
+                 .child_spread = otu.spread,
+                 .parent_spread = parent.spread};  // refactoring: child's stats should be initialized outside of the loop, or separated into another struct
+
+    // reject early: parent is present in too few samples
+    if (rejection.is_early_exit and
+        is_rejected(Ratios{}, std::min(otu.spread, parent.spread),
+                    otu.spread, rejection)) {
+      return false;
+    }
+
+    // compute parent/child ratios for all samples
+    if (pair_ratios(otu, parent, rejection, pair_cache, stats)) {
+      return false;  // rejection is certain, stats are incomplete
+    }
+
+    complete_stats(stats, parameters);
+    if (not is_accepted(stats, parameters)) {
+      return reject(stats);
+    }
+
+    // accept: mark OTU and output stats
+    stats.is_accepted = true;
+    otu.is_mergeable = true;
+    otu.parent = match.hit;
+    if (parameters.log_level != log_level_none) { log_records.push_back(stats); }
+    return true;
+  }
+
+
+  auto test_parents(std::vector<struct OTU> const &OTUs,
                     OTU &otu,
-                    const std::string &OTU_id,
                     Parameters const &parameters,
-                    std::ofstream &log_file) -> void {
-
+                    Pair_cache &pair_cache,
+                    std::vector<struct Stats> &log_records) -> void {
     assert(otu.spread != 0);  // empty child should be skipped
+    auto const rejection {get_rejection(parameters)};
+    // candidates are popped in order, as long as they are rejected
+    for (auto n_popped {0UL}; n_popped < otu.matches.size(); ++n_popped) {
+      auto const &match = pop_match(otu.matches, n_popped, parameters);
+      if (test_parent(OTUs, otu, match, parameters, rejection, pair_cache, log_records)) { break; }
+    }
+  }
 
-    for (auto const& match : otu.matches) {
-      auto const& parent = OTUs[match.hit_id];
-      Stats stats {.child_id = OTU_id,
-                   .parent_id = match.hit_id,
-                   .similarity = match.similarity,
-                   .child_total_abundance = otu.sum_reads,
-                   .parent_total_abundance = parent.sum_reads,
-                   .child_spread = otu.spread,
-                   .parent_spread = parent.spread};  // refactoring: child's stats should be initialized outside of the loop, or separated into another struct
-
-      // compute parent/child ratios for all samples
-      per_sample_ratios(OTUs, stats);
-
-      // reject: no overlap with the potential parent
-      if (stats.parent_overlap_spread == 0) {
-        stats.smallest_ratio = 0.0;
-        stats.smallest_non_null_ratio = 0.0;
-        log_file << stats;
-        continue;
-      }
 
-      // reject: replicate lulu's behavior (no partial overlap)
-      if (parameters.is_legacy and is_null(stats.smallest_ratio)) {
-        log_file << stats;
-        continue;
+  // --parent_major: test the potential parents of a range of query
+  // OTUs parent by parent. Each round tests the next candidate of all
+  // unresolved query OTUs, sorted by parent OTU: the samples of a
+  // parent are read once per round, and stay in cache while its query
+  // OTUs are tested. Log records are kept per query OTU, and output in
+  // the usual order
+  auto test_parents_by_parent(std::vector<struct OTU> &OTUs,
+                              std::size_t const first,
+                              std::size_t const last,
+                              Parameters const &parameters,
+                              Pair_cache &pair_cache,
+                              std::vector<struct Stats> &log_records) -> void {
+    struct Candidate {
+      std::uint32_t parent {0};
+      std::uint32_t child {0};
+      auto operator<=>(Candidate const &) const = default;
+    };
+
+    auto const rejection {get_rejection(parameters)};
+    std::vector<std::vector<struct Stats>> records(last - first);
+    std::vector<std::size_t> next_match(last - first, 0);
+    std::vector<struct Candidate> candidates;
+    for (auto i {first}; i < last; ++i) {
+      auto &otu = OTUs[i];
+      if (otu.spread == 0 or otu.matches.empty()) { continue; }
+      candidates.push_back({.parent = pop_match(otu.matches, 0, parameters).hit,
+                            .child = static_cast<std::uint32_t>(i)});
+    }
+
+    std::vector<struct Candidate> next_candidates;
+    while (not candidates.empty()) {
+      std::ranges::sort(candidates);
+      for (auto const candidate : candidates) {
+        auto &otu = OTUs[candidate.child];
+        auto &position = next_match[candidate.child - first];
+        // popped matches are stored at the end, in reverse order
+        auto const &match = otu.matches[otu.matches.size() - position - 1];
+        if (test_parent(OTUs, otu, match, parameters, rejection,
+                        pair_cache, records[candidate.child - first])) {
+          continue;  // first accepted parent: stop
+        }
+        ++position;
+        if (position == otu.matches.size()) { continue; }
+        next_candidates.push_back({.parent = pop_match(otu.matches, position, parameters).hit,
+                                   .child = candidate.child});
       }
+      std::swap(candidates, next_candidates);
+      next_candidates.clear();
+    }
 
-      // populate overlap stats
-      stats.avg_ratio = stats.sum_ratio / stats.child_spread;
-      stats.avg_non_null_ratio = stats.sum_ratio / stats.parent_overlap_spread;
-      stats.relative_cooccurrence = 1.0 * stats.parent_overlap_spread / stats.child_spread;
+    for (auto const &otu_records : records) {
+      log_records.insert(log_records.end(), otu_records.begin(), otu_records.end());
+    }
+  }
+
+
+  // query OTUs [first, last)
+  auto test_range(std::vector<struct OTU> &OTUs,
+                  std::size_t const first,
+                  std::size_t const last,
+                  Parameters const &parameters,
+                  Pair_cache &pair_cache,
+                  std::vector<struct Stats> &log_records) -> void {
+    if (parameters.is_parent_major) {
+      test_parents_by_parent(OTUs, first, last, parameters, pair_cache, log_records);
+      return;
+    }
+    for (auto i {first}; i < last; ++i) {
+      auto & otu = OTUs[i];
+      // ignore empty OTUs (no spread, no reads)
+      if (otu.spread == 0) { continue; }  // refactoring: move check to read_match_list()
+      test_parents(OTUs, otu, parameters, pair_cache, log_records);
+    }
+  }
+
+
+  // number of query OTUs tested at once. Parent-major batches are
+  // large, so that popular parents are shared by many query OTUs
+  auto get_batch_size(Parameters const &parameters) -> std::size_t {
+    static constexpr auto batch_size {std::size_t{16}};
+    static constexpr auto parent_major_batch_size {std::size_t{4096}};
+    return parameters.is_parent_major ? parent_major_batch_size : batch_size;
+  }
 
-      // reject: incidence ratio with the potential parent is too low
-      if (stats.relative_cooccurrence < parameters.minimum_relative_cooccurrence) {
-        log_file << stats;
-        continue;
-      }
 
-      // reject: abundance ratio with the potential parent is too low
-      if ((parameters.minimum_ratio_type == use_minimum_value and
-           stats.smallest_non_null_ratio <= parameters.minimum_ratio)
-          or (parameters.minimum_ratio_type == use_average_value and
-              stats.avg_non_null_ratio <= parameters.minimum_ratio)) {
-        log_file << stats;
-        continue;
+  // log records refer to OTUs by index
+  auto get_names(std::vector<struct OTU> const &OTUs) -> std::vector<std::string_view> {
+    std::vector<std::string_view> names;
+    names.reserve(OTUs.size());
+    for (auto const &otu : OTUs) {
+      names.emplace_back(otu.id);
+    }
+    return names;
+  }
+
+
+  // log records of a batch of consecutive OTUs
+  struct Batch {
+    std::vector<struct Stats> log_records;
+    std::atomic<bool> is_done {false};
+  };
+
+
+  auto search_parent_in_parallel(std::vector<struct OTU> &OTUs,
+                                 Parameters const &parameters,
+                                 Pair_cache &pair_cache,
+                                 Log_writer &log_writer) -> void {
+    // numbers of matches vary a lot: small batches are distributed
+    // to threads on demand
+    auto const batch_size {get_batch_size(parameters)};
+    auto const n_batches = (OTUs.size() + batch_size - 1) / batch_size;
+    std::vector<struct Batch> batches(n_batches);
+    std::atomic<std::size_t> next_batch {0};
+
+    auto const worker = [&]() -> void {
+      while (true) {
+        auto const batch_index = next_batch.fetch_add(1, std::memory_order_relaxed);
+        if (batch_index >= n_batches) { return; }
+        auto const first = batch_index * batch_size;
+        auto const last = std::min(first + batch_size, OTUs.size());
+        auto & batch = batches[batch_index];
+        test_range(OTUs, first, last, parameters, pair_cache, batch.log_records);
+        batch.is_done.store(true, std::memory_order_release);
+        batch.is_done.notify_one();
       }
+    };
+
+    std::vector<std::jthread> workers;
+    workers.reserve(parameters.threads);
+    for (auto i {0UL}; i < parameters.threads; ++i) {
+      workers.emplace_back(worker);
+    }
+
+    // log records are written in OTU order, as soon as possible
+    for (auto & batch : batches) {
+      batch.is_done.wait(false, std::memory_order_acquire);
+      log_writer.write(batch.log_records);
+    }
+  }
 
-      // accept: mark OTU and output stats
-      stats.status = accept_as_parent;
-      otu.is_mergeable = true;
-      otu.parent_id = match.hit_id;
-      log_file << stats;
-      break;
+
+  // --sweep: statistics of a pair of OTUs are computed (completely)
+  // the first time a parameter set needs them, and are then shared by
+  // the following parameter sets. Matches are popped as the deepest
+  // parameter set needs them (the nth match is at size - n - 1)
+  auto sweep_parents(std::vector<struct OTU> &OTUs,
+                     std::size_t const first,
+                     std::size_t const last,
+                     Parameters const &parameters,
+                     std::vector<struct Parameters> const &parameter_sets,
+                     Pair_cache &pair_cache,
+                     std::vector<std::vector<std::uint32_t>> &parents) -> void {
+    Rejection const no_early_exit {};
+    std::vector<std::optional<struct Stats>> pair_stats;
+    for (auto i {first}; i < last; ++i) {
+      auto &otu = OTUs[i];
+      if (otu.spread == 0) { continue; }
+      pair_stats.assign(otu.matches.size(), std::nullopt);
+      auto n_popped {0UL};
+      for (auto set {0UL}; set < parameter_sets.size(); ++set) {
+        for (auto j {0UL}; j < otu.matches.size(); ++j) {
+          if (j == n_popped) {
+            pop_match(otu.matches, n_popped, parameters);
+            ++n_popped;
+          }
+          auto const &match = otu.matches[otu.matches.size() - j - 1];
+          if (match.similarity < parameter_sets[set].minimum_match) { continue; }
+          auto &stats = pair_stats[j];
+          if (not stats) {
+            auto const& parent = OTUs[match.hit];
+            stats = Stats {.child = static_cast<std::uint32_t>(i),
+                           .parent = match.hit,
+                           .child_total_abundance = otu.sum_reads,
+                           .child_spread = otu.spread};
+            pair_ratios(otu, parent, no_early_exit, pair_cache, *stats);
+            complete_stats(*stats, parameters);
+          }
+          if (is_accepted(*stats, parameter_sets[set])) {
+            parents[set][i] = match.hit;
+            break;
+          }
+        }
+      }
     }
   }
 } // namespace
 
 
-auto search_parent(std::unordered_map<std::string, struct OTU> &OTUs,
+auto search_parent(std::vector<struct OTU> &OTUs,
                    Parameters const &parameters) -> void {
   std::cout << "search for potential parent OTUs... ";
   // stats will be written to log file
-  std::ofstream log_file {parameters.log};
-  print_log_header(log_file);
+  Log_writer log_writer {parameters, get_names(OTUs)};
+  Pair_cache pair_cache {parameters};
+
+  // thread safe: one OTU per thread, thread only modifies the OTU it
+  // is working on, other OTUs are read-only
+  if (parameters.threads > 1) {
+    search_parent_in_parallel(OTUs, parameters, pair_cache, log_writer);
+  }
+  else {
+    std::vector<struct Stats> log_records;
+    auto const batch_size {get_batch_size(parameters)};
+    for (auto first {0UL}; first < OTUs.size(); first += batch_size) {
+      test_range(OTUs, first, std::min(first + batch_size, OTUs.size()),
+                 parameters, pair_cache, log_records);
+      if (log_records.size() >= Log_writer::block_size) {
+        log_writer.write(log_records);
+      }
+    }
+    log_writer.write(log_records);
+  }
+  std::cout << "done\n";
+  pair_cache.save();
+}
 
-  for (auto const& otu : OTUs) {
-    auto const& OTU_id {otu.first};  // refactoring: replace with [first, second]?
 
-    // ignore empty OTUs (no spread, no reads)
-    if (OTUs[OTU_id].spread == 0) { continue; }  // refactoring: move check to read_match_list()
 
-    // test potential parents (thread safe: one OTU per thread, thread
-    // only modifies the OTU it is working on, other OTUs are
-    // read-only)
-    test_parents(OTUs, OTUs[OTU_id], OTU_id, parameters, log_file);
+auto search_parent(std::vector<struct OTU> &OTUs,
+                   struct Identifiers const &identifiers,
+                   Parameters const &parameters) -> void {
+  std::cout << "parse match list and search for potential parent OTUs... ";
+  Log_writer log_writer {parameters, get_names(OTUs)};
+  Pair_cache pair_cache {parameters};
+  std::vector<struct Stats> log_records;
+  auto const hit_ranks {rank_hits(OTUs, parameters)};
+
+  // only the matches of the current query OTU are in memory
+  auto const find_parent = [&](OTU &otu) {
+    if (otu.spread == 0) { return; }
+    heapify_matches(hit_ranks, otu, parameters);
+    test_parents(OTUs, otu, parameters, pair_cache, log_records);
+    if (log_records.size() >= Log_writer::block_size) {
+      log_writer.write(log_records);
+    }
+  };
+  if (parameters.is_grouped_match_list) {
+    read_grouped_match_list(OTUs, identifiers, parameters, find_parent);
   }
+  else {
+    sort_match_list_externally(OTUs, identifiers, parameters, find_parent);
+  }
+  log_writer.write(log_records);
   std::cout << "done\n";
+  pair_cache.save();
 }
 
 
-// refactoring:
-// Move the Stats struct definition to its own header file to better
-// separate concerns. This improves modularity and organization.
+auto search_parent(std::vector<struct OTU> &OTUs,
+                   Parameters const &parameters,
+                   std::vector<struct Parameters> const &parameter_sets)
+  -> std::vector<std::vector<std::uint32_t>> {
+  std::cout << "search for potential parent OTUs (" << parameter_sets.size()
+            << " parameter sets)... ";
+  // by default, OTUs are their own parent
+  std::vector<std::uint32_t> no_parents(OTUs.size());
+  std::iota(no_parents.begin(), no_parents.end(), std::uint32_t{0});
+  std::vector<std::vector<std::uint32_t>> parents(parameter_sets.size(), no_parents);
+  Pair_cache pair_cache {parameters};
+
+  // threads only modify the parents of their query OTUs
+  static constexpr auto batch_size {std::size_t{16}};
+  std::atomic<std::size_t> next_batch {0};
+  auto const worker = [&]() -> void {
+    while (true) {
+      auto const first = next_batch.fetch_add(1, std::memory_order_relaxed) * batch_size;
+      if (first >= OTUs.size()) { return; }
+      sweep_parents(OTUs, first, std::min(first + batch_size, OTUs.size()),
+                    parameters, parameter_sets, pair_cache, parents);
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(parameters.threads);
+    for (auto i {0UL}; i < parameters.threads; ++i) {
+      workers.emplace_back(worker);
+    }
+  }
+  std::cout << "done\n";
+  pair_cache.save();
+  return parents;
+}
+
 
+// refactoring:
 // Use C++20 ranges and views like zip to iterate over the samples
 // instead of manual indexing. This makes the code more idiomatic and
 // reduces errors.
@@ -254,7 +572,3 @@ auto search_parent(std::unordered_map<std::string, struct OTU> &OTUs,
 // Initialize child stats outside the parent testing loop to avoid
 // repeated work. This improves performance by avoiding redundant
 // computations.
-
-// Use std::string_view instead of std::string for IDs to avoid
-// unnecessary copying. This optimizes performance when passing
-// strings around.
@@ -21,8 +21,23 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
-#include <string>
-#include <unordered_map>
+#include <cstdint>  // std::uint32_t
+#include <vector>
 
-auto search_parent(std::unordered_map<std::string, struct OTU> &OTUs,
+auto search_parent(std::vector<struct OTU> &OTUs,
                    struct Parameters const &parameters) -> void;
+
+// grouped match lists, or a memory budget: matches are parsed,
+// sorted and tested one query OTU at a time
+auto search_parent(std::vector<struct OTU> &OTUs,
+                   struct Identifiers const &identifiers,
+                   struct Parameters const &parameters) -> void;
+
+// --sweep: for each parameter set, the index of the parent of each
+// OTU (or of the OTU itself). Statistics of each pair of OTUs are
+// computed once, and shared by all parameter sets (lists of matches
+// are heapified, see heapify_matches())
+auto search_parent(std::vector<struct OTU> &OTUs,
+                   struct Parameters const &parameters,
+                   std::vector<struct Parameters> const &parameter_sets)
+  -> std::vector<std::vector<std::uint32_t>>;
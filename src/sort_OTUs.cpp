@@ -0,0 +1,109 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::ranges::transform
+#include <climits>  // CHAR_BIT
+#include <cstdint>  // std::uint32_t, std::uint64_t
+#include <string_view>
+#include <vector>
+#include "mumu.hpp"
+#include "parallel_sort.hpp"
+#include "sort_OTUs.hpp"
+
+
+namespace {
+
+  // packed sort key (24 bytes, no copy of OTU names): abundance,
+  // spread and OTU index, and the first eight bytes of the OTU name
+  // (big-endian, same order as std::string_view comparisons). Full
+  // names are read only to break ties between equal prefixes
+  struct Sort_key {
+    std::uint64_t abundance {0};
+    std::uint64_t spread_and_index {0};
+    std::uint64_t prefix {0};
+
+    [[nodiscard]] auto spread() const -> std::uint64_t {
+      return spread_and_index >> 32U;
+    }
+
+    [[nodiscard]] auto index() const -> std::uint32_t {
+      return static_cast<std::uint32_t>(spread_and_index);
+    }
+  };
+
+
+  [[nodiscard]]
+  auto get_prefix(std::string_view const OTU_id) -> std::uint64_t {
+    auto prefix {std::uint64_t{0}};
+    for (auto i {0UL}; i < sizeof(prefix); ++i) {
+      prefix <<= CHAR_BIT;
+      if (i < OTU_id.size()) {
+        prefix |= static_cast<unsigned char>(OTU_id[i]);
+      }
+    }
+    return prefix;
+  }
+
+
+  [[nodiscard]]
+  auto extract_sort_keys(std::vector<struct OTU> const &OTUs)
+    -> std::vector<struct Sort_key> {
+    std::vector<struct Sort_key> sort_keys;
+    sort_keys.reserve(OTUs.size());
+    for (auto index {0U}; auto const& otu: OTUs) {
+      if (not otu.is_merged) {  // skip merged OTUs
+        sort_keys.push_back(Sort_key {
+            .abundance = otu.sum_reads,
+            .spread_and_index = (std::uint64_t{otu.spread} << 32U) | index,
+            .prefix = get_prefix(otu.id)}
+          );
+      }
+      ++index;
+    }
+    return sort_keys;
+  }
+
+}  // namespace
+
+
+auto sort_OTUs(std::vector<struct OTU> const &OTUs,
+               unsigned long int const n_threads) -> std::vector<std::uint32_t> {
+  auto const compare = [&OTUs](Sort_key const &lhs, Sort_key const &rhs) -> bool {
+    if (lhs.abundance != rhs.abundance) {
+      return lhs.abundance > rhs.abundance;
+    }
+    if (lhs.spread() != rhs.spread()) {
+      return lhs.spread() > rhs.spread();
+    }
+    if (lhs.prefix != rhs.prefix) {
+      return lhs.prefix < rhs.prefix;
+    }
+    return OTUs[lhs.index()].id < OTUs[rhs.index()].id;
+  };
+  auto sort_keys {extract_sort_keys(OTUs)};
+  parallel_sort(sort_keys, compare, n_threads);
+
+  std::vector<std::uint32_t> sorted_OTUs(sort_keys.size());
+  std::ranges::transform(sort_keys, sorted_OTUs.begin(), &Sort_key::index);
+  return sorted_OTUs;
+}
@@ -0,0 +1,31 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <cstdint>  // std::uint32_t
+#include <vector>
+
+// indices of unmerged OTUs, by decreasing abundance, decreasing
+// spread, and increasing lexicographic ID order (A, B, ..., a, b, c,
+// ...); large tables are sorted in parallel
+auto sort_OTUs(std::vector<struct OTU> const &OTUs,
+               unsigned long int n_threads) -> std::vector<std::uint32_t>;
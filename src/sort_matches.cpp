@@ -22,80 +22,173 @@
 // France
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>  // std::ptrdiff_t, std::size_t
+#include <cstdint>  // std::uint32_t, std::uint64_t
 #include <iostream>
-#include <functional>
-#include <string>
-#include <unordered_map>
+#include <iterator>  // std::prev
+#include <thread>
+#include <tuple>
+#include <vector>
 #include "mumu.hpp"
+#include "parallel_sort.hpp"
+#include "sort_OTUs.hpp"
+#include "sort_matches.hpp"
 
 
 namespace {
 
-  auto sort_matches_mumu(std::unordered_map<std::string, struct OTU> & OTUs) -> void {
-    std::cout << "(mumu order) ... ";
-    // refactor as range view
-    for (auto const& otu : OTUs) {
-      auto const & OTU_id {otu.first};
+  // mumu order: potential parents are ranked by decreasing
+  // abundance, decreasing spread, and lexicographic order (A, B, ...,
+  // a, b, c, ...)
+  auto rank_hits_mumu(std::vector<struct OTU> const & OTUs,
+                      unsigned long int const n_threads) -> std::vector<std::uint32_t> {
+    return sort_OTUs(OTUs, n_threads);
+  }
 
-      // ignore OTUs with zero or one match
-      if (OTUs[OTU_id].matches.size() < 2) { continue; }  // refactoring: useless?
 
-      std::ranges::sort(OTUs[OTU_id].matches, std::ranges::greater{});  // refactoring: replace with otu.matches!
+  // lulu orders matches with potential parents by decreasing spread
+  // (incidence), and then by decreasing total abundance, and then
+  // (implicitely) by input order (of OTUs)
+  // R code: order(spread, total, decreasing = TRUE)
+  auto rank_hits_legacy(std::vector<struct OTU> const & OTUs,
+                        unsigned long int const n_threads) -> std::vector<std::uint32_t> {
+    struct Sort_key {
+      std::uint64_t spread_and_index {0};
+      std::uint64_t abundance {0};
+    };
+    std::vector<struct Sort_key> sort_keys;
+    sort_keys.reserve(OTUs.size());
+    for (auto index {0U}; auto const& otu: OTUs) {
+      sort_keys.push_back(Sort_key {
+          .spread_and_index = (std::uint64_t{otu.spread} << 32U) | index,
+          .abundance = otu.sum_reads}
+        );
+      ++index;
     }
+    auto const compare = [](Sort_key const &lhs, Sort_key const &rhs) -> bool {
+      auto const lhs_spread = lhs.spread_and_index >> 32U;
+      auto const rhs_spread = rhs.spread_and_index >> 32U;
+      if (lhs_spread != rhs_spread) {
+        return lhs_spread > rhs_spread;
+      }
+      if (lhs.abundance != rhs.abundance) {
+        return lhs.abundance > rhs.abundance;
+      }
+      return lhs.spread_and_index < rhs.spread_and_index;  // input order
+    };
+    parallel_sort(sort_keys, compare, n_threads);
+
+    std::vector<std::uint32_t> sorted_OTUs(sort_keys.size());
+    std::ranges::transform(sort_keys, sorted_OTUs.begin(),
+                           [](Sort_key const &key) {
+                             return static_cast<std::uint32_t>(key.spread_and_index);
+                           });
+    return sorted_OTUs;
   }
 
 
-  auto sort_matches_legacy(std::unordered_map<std::string, struct OTU> & OTUs) -> void {
-    // lulu orders matches with potential parents by decreasing spread
-    // (incidence), and then by decreasing total abundance, and then
-    // (implicitely) by input order (of OTUs)
-    // R code: order(spread, total, decreasing = TRUE)
-    std::cout << "(legacy order) ... ";
+  // mumu: decreasing similarity, then hit rank (is_worse(a, b): a is
+  // tested after b)
+  auto is_worse(Match const &lhs, Match const &rhs) -> bool {
+    return std::tie(lhs.similarity, rhs.rank) < std::tie(rhs.similarity, lhs.rank);
+  }
 
-    auto compare_matches = [](struct Match const& lhs,
-                              struct Match const& rhs) -> bool {
-      // sort by decreasing spread...
-      if (lhs.hit_spread > rhs.hit_spread) {
-        return true;
-      }
-      if (lhs.hit_spread < rhs.hit_spread) {
-        return false;
-      }
-      // ...then ties are sorted by decreasing total abundance
-      if (lhs.hit_sum_reads > rhs.hit_sum_reads) {
-        return true;
-      }
-      if (lhs.hit_sum_reads < rhs.hit_sum_reads) {
-        return false;
-      }
-      // ...then ties are sorted by increasing input order of OTUs
-      if (lhs.hit_input_order < rhs.hit_input_order) {
-        return true;
-      }
-      return false;
-    };
 
-    for (auto const& otu : OTUs) {
-      auto const & OTU_id {otu.first};
+  // legacy: hit rank only. Matches repeated in the match list (same
+  // pair of OTUs) keep their input order (stable sort)
+  auto is_better_legacy(Match const &lhs, Match const &rhs) -> bool {
+    return lhs.rank < rhs.rank;
+  }
 
-      // ignore OTUs with zero or one match
-      if (OTUs[OTU_id].matches.size() < 2) { continue; }  // refactoring: useless?
 
-      std::ranges::sort(OTUs[OTU_id].matches, compare_matches);
+  // a heap cannot keep the input order of repeated matches: legacy
+  // lists are sorted at once, in reverse order (the first match to
+  // test is popped from the end of the list)
+  auto heapify_match_list(std::vector<std::uint32_t> const &hit_ranks,
+                          std::vector<struct Match> &matches,
+                          bool const is_legacy) -> void {
+    for (auto &match: matches) {
+      match.rank = hit_ranks[match.hit];
+    }
+    if (is_legacy) {
+      std::ranges::stable_sort(matches, is_better_legacy);
+      std::ranges::reverse(matches);
+      return;
     }
+    std::ranges::make_heap(matches, is_worse);
   }
 
 }  // namespace
 
 
+auto rank_hits(std::vector<struct OTU> const &OTUs,
+               struct Parameters const &parameters) -> std::vector<std::uint32_t> {
+  auto const sorted_OTUs = parameters.is_legacy ?
+    rank_hits_legacy(OTUs, parameters.threads) :
+    rank_hits_mumu(OTUs, parameters.threads);
+  std::vector<std::uint32_t> hit_ranks(OTUs.size());
+  for (auto rank {0U}; auto const index: sorted_OTUs) {
+    hit_ranks[index] = rank;
+    ++rank;
+  }
+  return hit_ranks;
+}
+
 
-auto sort_matches(std::unordered_map<std::string, struct OTU> &OTUs,
-                  struct Parameters const &parameters) -> void {
+auto heapify_matches(std::vector<struct OTU> &OTUs,
+                     struct Parameters const &parameters) -> void {
+  static constexpr auto block_size {std::size_t{64}};
   std::cout << "sort lists of matches... ";
-  if (parameters.is_legacy) {
-    sort_matches_legacy(OTUs);
-  } else {
-    sort_matches_mumu(OTUs);
+  std::cout << (parameters.is_legacy ? "(legacy order) ... " : "(mumu order) ... ");
+  auto const hit_ranks {rank_hits(OTUs, parameters)};
+  std::atomic<std::size_t> next_block {0};
+  auto const worker = [&]() -> void {
+    while (true) {
+      auto const first = next_block.fetch_add(block_size, std::memory_order_relaxed);
+      if (first >= OTUs.size()) { return; }
+      auto const last = std::min(first + block_size, OTUs.size());
+      for (auto i {first}; i < last; ++i) {
+        heapify_match_list(hit_ranks, OTUs[i].matches, parameters.is_legacy);
+      }
+    }
+  };
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(parameters.threads);
+    for (auto i {0UL}; i < parameters.threads; ++i) {
+      workers.emplace_back(worker);
+    }
   }
   std::cout << "done\n";
 }
+
+
+auto heapify_matches(std::vector<std::uint32_t> const &hit_ranks,
+                     struct OTU &otu,
+                     struct Parameters const &parameters) -> void {
+  heapify_match_list(hit_ranks, otu.matches, parameters.is_legacy);
+}
+
+
+auto pop_match(std::vector<struct Match> &matches,
+               std::size_t const n_popped,
+               struct Parameters const &parameters) -> struct Match const & {
+  // most query OTUs find a parent among their first candidates, or
+  // not at all: past that point, the rest of the heap is sorted at
+  // once (cheaper than popping matches one by one)
+  static constexpr auto max_pops {std::size_t{16}};
+  assert(n_popped < matches.size());
+  auto const end_of_heap = std::prev(matches.end(), static_cast<std::ptrdiff_t>(n_popped));
+  if (parameters.is_legacy) {  // already sorted
+    return *std::prev(end_of_heap);
+  }
+  if (n_popped < max_pops) {
+    std::ranges::pop_heap(matches.begin(), end_of_heap, is_worse);
+  }
+  else if (n_popped == max_pops) {
+    std::ranges::sort(matches.begin(), end_of_heap, is_worse);
+  }
+  return *std::prev(end_of_heap);
+}
@@ -21,8 +21,31 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
-#include <string>
-#include <unordered_map>
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
+#include <vector>
 
-auto sort_matches(std::unordered_map<std::string, struct OTU> &OTUs,
-                  struct Parameters const &parameters) -> void;
+// rank of each OTU in the potential parent order, computed once
+auto rank_hits(std::vector<struct OTU> const &OTUs,
+               struct Parameters const &parameters) -> std::vector<std::uint32_t>;
+
+// matches are tested by decreasing similarity, and then by potential
+// parent order (mumu order), or by potential parent order only,
+// repeated matches keeping their input order (legacy order). Store
+// hit ranks, and turn lists of matches into heaps: matches are popped
+// only when they are needed (see pop_match()). Legacy lists are
+// sorted at once, to keep the input order of repeated matches
+auto heapify_matches(std::vector<struct OTU> &OTUs,
+                     struct Parameters const &parameters) -> void;
+
+// heapify the matches of a single OTU (grouped match lists)
+auto heapify_matches(std::vector<std::uint32_t> const &hit_ranks,
+                     struct OTU &otu,
+                     struct Parameters const &parameters) -> void;
+
+// next match of a heapified list, once n_popped matches have been
+// popped. Popped matches are stored at the end of the list, in
+// reverse order: the nth match is at position size - n - 1
+auto pop_match(std::vector<struct Match> &matches,
+               std::size_t n_popped,
+               struct Parameters const &parameters) -> struct Match const &;
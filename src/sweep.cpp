@@ -0,0 +1,187 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <algorithm>  // std::ranges::min, std::ranges::count
+#include <charconv>  // std::from_chars
+#include <cmath>  // std::nextafter
+#include <cstdint>  // std::uint32_t
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>  // std::errc
+#include <vector>
+#include "mumu.hpp"
+#include "load_OTUs.hpp"
+#include "load_matches.hpp"
+#include "merge_OTUs.hpp"
+#include "search_parent.hpp"
+#include "sort_matches.hpp"
+#include "utils.hpp"
+#include "validate_args.hpp"
+#include "write_table.hpp"
+
+
+namespace {
+
+  // tab-separated values of a parameter set, as written in the
+  // parameter file
+  constexpr auto n_values {4U};
+
+  struct Parameter_sets {
+    std::vector<struct Parameters> parameters;
+    std::vector<std::string> values;
+  };
+
+
+  auto parse_double(std::string_view const value, double &result) -> bool {
+    auto const [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    return error == std::errc{} and end == value.data() + value.size();
+  }
+
+
+  // minimum_match, minimum_ratio_type, minimum_ratio,
+  // minimum_relative_cooccurrence (empty lines and lines starting
+  // with '#' are ignored)
+  [[nodiscard]]
+  auto read_parameter_sets(struct Parameters const &parameters) -> struct Parameter_sets {
+    static constexpr auto largest_double {std::numeric_limits<double>::max()};
+    Parameter_sets parameter_sets;
+    std::ifstream sweep_file {parameters.sweep};
+    std::string line;
+    auto line_number {0UL};
+    while (std::getline(sweep_file, line)) {
+      ++line_number;
+      if (line.empty() or line.starts_with('#')) { continue; }
+      auto const invalid_line = [&]() {
+        fatal("--sweep: invalid parameter set on line " + std::to_string(line_number) +
+              " of " + parameters.sweep);
+      };
+      if (std::ranges::count(line, sepchar) != n_values - 1) { invalid_line(); }
+
+      std::vector<std::string_view> values;
+      std::string_view remaining {line};
+      for (auto i {0U}; i < n_values; ++i) {
+        auto const end_of_value = remaining.find(sepchar);
+        values.push_back(remaining.substr(0, end_of_value));
+        remaining.remove_prefix(std::min(values.back().size() + 1, remaining.size()));
+      }
+
+      auto set {parameters};
+      if (not parse_double(values[0], set.minimum_match)
+          or not parse_double(values[2], set.minimum_ratio)
+          or not parse_double(values[3], set.minimum_relative_cooccurrence)) {
+        invalid_line();
+      }
+      if (values[1] == use_minimum_value) {
+        set.minimum_ratio_type = use_minimum_value;
+      }
+      else if (values[1] == use_average_value) {
+        set.minimum_ratio_type = use_average_value;
+      }
+      else {
+        invalid_line();
+      }
+      // same as --minimum_match: in legacy mode, match values equal
+      // to the threshold are excluded (like lulu)
+      if (parameters.is_legacy) {
+        set.minimum_match = std::nextafter(set.minimum_match, largest_double);
+      }
+      check_numerical_parameters(set);
+      parameter_sets.parameters.push_back(set);
+      parameter_sets.values.push_back(line);
+    }
+    if (parameter_sets.parameters.empty()) {
+      fatal("--sweep: no parameter set in " + parameters.sweep);
+    }
+    return parameter_sets;
+  }
+
+
+  auto print_summary_header(std::ofstream &summary) -> void {
+    summary
+      << "set" << sepchar
+      << "minimum_match" << sepchar
+      << "minimum_ratio_type" << sepchar
+      << "minimum_ratio" << sepchar
+      << "minimum_relative_cooccurrence" << sepchar
+      << "merged_OTUs" << sepchar
+      << "remaining_OTUs" << sepchar
+      << "new_otu_table" << '\n';
+  }
+}  // namespace
+
+
+auto sweep(struct Parameters const &parameters) -> void {
+  auto const parameter_sets {read_parameter_sets(parameters)};
+
+  // load matches needed by at least one parameter set
+  auto load_parameters {parameters};
+  load_parameters.minimum_match = std::ranges::min(
+      parameter_sets.parameters, {}, &Parameters::minimum_match).minimum_match;
+  std::vector<struct OTU> OTUs;
+  Identifiers identifiers;
+  std::string header;
+  auto const n_samples {read_otu_table(OTUs, identifiers, load_parameters, header)};
+  read_match_list(OTUs, identifiers, load_parameters);
+  identifiers.index = {};
+  heapify_matches(OTUs, load_parameters);
+
+  auto const parents {search_parent(OTUs, parameters, parameter_sets.parameters)};
+  for (auto & otu : OTUs) {
+    otu.matches = {};  // not needed anymore
+  }
+
+  // one new OTU table per parameter set (the file set with
+  // --new_otu_table is never opened)
+  std::ofstream summary {parameters.log};
+  print_summary_header(summary);
+  for (auto set {0UL}; set < parents.size(); ++set) {
+    auto const set_number {std::to_string(set + 1)};
+    std::cout << "parameter set " << set_number << ":\n";
+    auto new_OTUs {OTUs};
+    auto n_merged {0UL};
+    for (auto i {0UL}; i < new_OTUs.size(); ++i) {
+      if (parents[set][i] == i) { continue; }
+      new_OTUs[i].is_mergeable = true;
+      new_OTUs[i].parent = parents[set][i];
+      ++n_merged;
+    }
+    merge_OTUs(new_OTUs, parameters.threads);
+    auto const new_otu_table_name {parameters.new_otu_table + '.' + set_number};
+    {
+      std::ofstream new_otu_table {new_otu_table_name};
+      if (not new_otu_table) {
+        fatal("can't open output file " + new_otu_table_name);
+      }
+      new_otu_table << header << '\n';
+    }
+    write_table(new_OTUs, n_samples, new_otu_table_name, parameters.threads);
+    summary << set_number << sepchar
+            << parameter_sets.values[set] << sepchar
+            << n_merged << sepchar
+            << new_OTUs.size() - n_merged << sepchar
+            << new_otu_table_name << '\n';
+  }
+}
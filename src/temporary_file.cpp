@@ -0,0 +1,92 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <stdlib.h>  // mkstemp  // NOLINT(modernize-deprecated-headers)
+#include <unistd.h>  // close, pread, unlink, write
+#include <algorithm>  // std::min
+#include <cstddef>  // std::byte, std::size_t
+#include <cstdlib>  // std::getenv
+#include <span>
+#include <string>
+#include "mumu.hpp"
+#include "temporary_file.hpp"
+#include "utils.hpp"
+
+
+Temporary_file::Temporary_file(std::string const &directory) {
+  auto path = directory + "/mumu_XXXXXX";
+  file_descriptor_ = mkstemp(path.data());
+  if (file_descriptor_ == -1) {
+    fatal("can't create a temporary file in " + directory);
+  }
+  unlink(path.c_str());
+}
+
+
+Temporary_file::~Temporary_file() {
+  close(file_descriptor_);
+}
+
+
+auto Temporary_file::append(std::span<std::byte const> const bytes) -> void {
+  auto const * data = bytes.data();
+  auto remaining = bytes.size();
+  while (remaining != 0) {
+    auto const n_written = write(file_descriptor_, data, remaining);
+    if (n_written <= 0) { fatal("can't write to temporary file (disk full?)"); }
+    data += n_written;
+    remaining -= static_cast<std::size_t>(n_written);
+  }
+  size_ += bytes.size();
+}
+
+
+auto Temporary_file::read(std::size_t const offset,
+                          std::span<std::byte> const buffer) const -> std::size_t {
+  auto const n_bytes = std::min(buffer.size(), size_ - offset);
+  auto * data = buffer.data();
+  auto remaining = n_bytes;
+  auto position = static_cast<off_t>(offset);
+  while (remaining != 0) {
+    auto const n_read = pread(file_descriptor_, data, remaining, position);
+    if (n_read <= 0) { fatal("can't read from temporary file"); }
+    data += n_read;
+    position += n_read;
+    remaining -= static_cast<std::size_t>(n_read);
+  }
+  return n_bytes;
+}
+
+
+auto Temporary_file::size() const -> std::size_t {
+  return size_;
+}
+
+
+auto get_temporary_directory(struct Parameters const &parameters) -> std::string {
+  if (not parameters.temporary_directory.empty()) {
+    return parameters.temporary_directory;
+  }
+  auto const * const tmpdir = std::getenv("TMPDIR");  // NOLINT(concurrency-mt-unsafe)
+  return (tmpdir == nullptr or *tmpdir == '\0') ? "/tmp" : tmpdir;
+}
@@ -0,0 +1,53 @@
+// MUMU
+
+// Copyright (C) 2020-2026 Frederic Mahe
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Contact: Frederic Mahe <frederic.mahe@cirad.fr>,
+// UMR PHIM, CIRAD - TA A-120/K
+// Campus International de Baillarguet
+// 34398 MONTPELLIER CEDEX 5
+// France
+
+#include <cstddef>  // std::byte, std::size_t
+#include <span>
+#include <string>
+
+
+// anonymous temporary file (unlinked as soon as it is created: disk
+// space is released when the file is closed, or when mumu stops)
+class Temporary_file {
+public:
+  explicit Temporary_file(std::string const &directory);
+  ~Temporary_file();
+  Temporary_file(Temporary_file const &) = delete;
+  Temporary_file(Temporary_file &&) = delete;
+  auto operator=(Temporary_file const &) -> Temporary_file & = delete;
+  auto operator=(Temporary_file &&) -> Temporary_file & = delete;
+
+  auto append(std::span<std::byte const> bytes) -> void;
+  // fill the buffer, starting at 'offset' (in bytes), and return the
+  // number of bytes read
+  auto read(std::size_t offset, std::span<std::byte> buffer) const -> std::size_t;
+  [[nodiscard]] auto size() const -> std::size_t;  // in bytes
+
+private:
+  int file_descriptor_ {-1};
+  std::size_t size_ {0};
+};
+
+
+// --temporary_directory, or TMPDIR, or /tmp
+auto get_temporary_directory(struct Parameters const &parameters) -> std::string;
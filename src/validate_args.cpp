@@ -21,9 +21,11 @@
 // 34398 MONTPELLIER CEDEX 5
 // France
 
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <system_error>  // std::error_code
 #include "mumu.hpp"
 #include "utils.hpp"
 
@@ -53,11 +55,17 @@ namespace {
         fatal("can't open input file " + file_name);
       }
     }
+    if (parameters.is_sweep and not std::ifstream {parameters.sweep}) {
+      fatal("can't open input file " + parameters.sweep);
+    }
   }
 
 
   auto output_files_are_writable(Parameters const &parameters) -> void {
     for (const auto& file_name : {parameters.new_otu_table, parameters.log} ) {
+      // --sweep: new OTU tables are only named after --new_otu_table
+      // (checked when they are written), the file itself is not used
+      if (parameters.is_sweep and file_name == parameters.new_otu_table) { continue; }
       const std::ofstream output_file {file_name};
       if (not output_file) {
         fatal("can't open input file " + file_name);
@@ -66,53 +74,111 @@ namespace {
   }
 
 
-  auto check_numerical_parameters(Parameters const &parameters) -> void {
-    // minimum match (50 <= x <= 100)
-    constexpr static auto lowest_similarity {50.0};
-    constexpr static auto highest_similarity {100.0};
-    if (parameters.minimum_match < lowest_similarity
-        or parameters.minimum_match > highest_similarity) {
-      fatal("--minimum_match value must be between " +
-            std::to_string(lowest_similarity) +
-            " and " +
-            std::to_string(highest_similarity));
-    }
-
-    // minimum ratio (x > 0)
-    if (parameters.minimum_ratio <= 0) {
-      fatal("--minimum_ratio value must be greater than zero");
+  auto check_conversion_arguments(Parameters const &parameters) -> void {
+    if (not parameters.is_log) {
+      fatal("missing mandatory argument --log filename");
     }
-
-    // minimum relative cooccurrence (0 < x <= 1)
-    if (parameters.minimum_relative_cooccurrence <= 0.0 or
-        parameters.minimum_relative_cooccurrence > 1.0) {
-      fatal("--minimum_relative_cooccurrence value must be between zero and one");
+    const std::ifstream input_file {parameters.log_to_tsv};
+    if (not input_file) {
+      fatal("can't open input file " + parameters.log_to_tsv);
     }
-
-    // threads (1 <= x <= 255)
-    constexpr static auto max_threads {255};
-    if (parameters.threads != 1) {
-      warn("mumu is not yet multithreaded");
+    // the output file is truncated later, after the conversion
+    // started: it can't be the binary log itself
+    std::error_code error;
+    if (std::filesystem::equivalent(parameters.log_to_tsv, parameters.log, error)) {
+      fatal("--log and --log_to_tsv must be different files: " + parameters.log);
     }
-    if (parameters.threads < 1 or parameters.threads > max_threads) {
-      fatal("--threads value must be between 1 and " + std::to_string(max_threads));
+    const std::ofstream output_file {parameters.log, std::ios_base::app};  // no truncation
+    if (not output_file) {
+      fatal("can't open output file " + parameters.log);
     }
+  }
+
 
-    // minimum ratio type ("min" or "avg")  // replace != with not_eq?
-    if (parameters.minimum_ratio_type != use_minimum_value and
-        parameters.minimum_ratio_type != use_average_value) {
-      fatal("--minimum ratio type can only be " +
-            std::string{use_minimum_value} +
-            "\" or \"" +
-            std::string{use_average_value});
+  auto temporary_directory_exists(Parameters const &parameters) -> void {
+    if (parameters.temporary_directory.empty()) { return; }
+    if (not std::filesystem::is_directory(parameters.temporary_directory)) {
+      fatal("can't find temporary directory " + parameters.temporary_directory);
     }
   }
 } // namespace
 
 
+auto check_numerical_parameters(Parameters const &parameters) -> void {
+  // minimum match (50 <= x <= 100)
+  constexpr static auto lowest_similarity {50.0};
+  constexpr static auto highest_similarity {100.0};
+  if (parameters.minimum_match < lowest_similarity
+      or parameters.minimum_match > highest_similarity) {
+    fatal("--minimum_match value must be between " +
+          std::to_string(lowest_similarity) +
+          " and " +
+          std::to_string(highest_similarity));
+  }
+
+  // minimum ratio (x > 0)
+  if (parameters.minimum_ratio <= 0) {
+    fatal("--minimum_ratio value must be greater than zero");
+  }
+
+  // minimum relative cooccurrence (0 < x <= 1)
+  if (parameters.minimum_relative_cooccurrence <= 0.0 or
+      parameters.minimum_relative_cooccurrence > 1.0) {
+    fatal("--minimum_relative_cooccurrence value must be between zero and one");
+  }
+
+  // threads (1 <= x <= 255)
+  constexpr static auto max_threads {255};
+  if (parameters.threads < 1 or parameters.threads > max_threads) {
+    fatal("--threads value must be between 1 and " + std::to_string(max_threads));
+  }
+
+  // memory budget (1 <= x <= 1 TiB, in MiB), if any
+  constexpr static auto max_memory_budget {1UL << 20U};
+  if (parameters.is_memory_budget and
+      (parameters.memory_budget < 1 or parameters.memory_budget > max_memory_budget)) {
+    fatal("--memory_budget value must be between 1 and " +
+          std::to_string(max_memory_budget) + " (MiB)");
+  }
+
+  // minimum ratio type ("min" or "avg")  // replace != with not_eq?
+  if (parameters.minimum_ratio_type != use_minimum_value and
+      parameters.minimum_ratio_type != use_average_value) {
+    fatal("--minimum ratio type can only be " +
+          std::string{use_minimum_value} +
+          "\" or \"" +
+          std::string{use_average_value});
+  }
+
+  // log level ("full", "accepted" or "none")
+  if (parameters.log_level != log_level_full and
+      parameters.log_level != log_level_accepted and
+      parameters.log_level != log_level_none) {
+    fatal("--log_level can only be \"" +
+          std::string{log_level_full} + "\", \"" +
+          std::string{log_level_accepted} + "\" or \"" +
+          std::string{log_level_none} + "\"");
+  }
+
+  // log format ("tsv" or "binary")
+  if (parameters.log_format != log_format_tsv and
+      parameters.log_format != log_format_binary) {
+    fatal("--log_format can only be \"" +
+          std::string{log_format_tsv} + "\" or \"" +
+          std::string{log_format_binary} + "\"");
+  }
+}
+
+
 auto validate_args(Parameters const &parameters) -> void {
+  if (parameters.is_log_to_tsv) {
+    // conversion mode: a binary log in, a tab-separated log out
+    check_conversion_arguments(parameters);
+    return;
+  }
   check_mandatory_arguments(parameters);
   input_files_are_reachable(parameters);
   output_files_are_writable(parameters);
   check_numerical_parameters(parameters);
+  temporary_directory_exists(parameters);
 }
@@ -22,3 +22,7 @@
 // France
 
 auto validate_args (struct Parameters const &parameters) -> void;
+
+// thresholds and other numerical parameters (also used for each
+// parameter set of --sweep)
+auto check_numerical_parameters (struct Parameters const &parameters) -> void;
@@ -22,78 +22,157 @@
 // France
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <charconv>  // std::to_chars
+#include <cstddef>  // std::size_t
+#include <cstdint>  // std::uint32_t
 #include <fstream>
-#include <functional>
+#include <iterator>  // std::next
 #include <ios>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <system_error>  // std::errc
+#include <thread>
 #include <vector>
-#include <unordered_map>
-#include <tuple>
 #include "mumu.hpp"
+#include "sort_OTUs.hpp"
 
 
 namespace {
 
-  struct OTU_stats {
-    std::string OTU_id;  // should be a string_view
-    long int spread {0};  // refactor; type is not correct
-    unsigned long int abundance {0};
-
-    auto operator<=>(OTU_stats const& rhs) const {
-      // order by abundance,
-      // if equal, order by spread,
-      // if equal, lexicographic ID order (A, B, ..., a, b, c, ...)
-      return
-        std::tie(abundance, spread, rhs.OTU_id) <=>
-        std::tie(rhs.abundance, rhs.spread, OTU_id);
-    }
+  // largest unsigned long int: 20 digits
+  constexpr auto max_number_length {
+    std::size_t{std::numeric_limits<unsigned long int>::digits10 + 1}};
 
-    // clang 22: warning: member function 'operator==' is not needed and will not be emitted [-Wunneeded-member-function]
-    auto operator==(OTU_stats const& rhs) const -> bool = default;
-  };
 
+  // write a tab and the value, return the new end of the buffer
+  auto put_number(char * const first, unsigned long int const value) -> char * {
+    *first = sepchar;
+    [[maybe_unused]] auto const [last, error] =
+      std::to_chars(first + 1, first + 1 + max_number_length, value);
+    assert(error == std::errc{});
+    return last;
+  }
 
-  [[nodiscard]]
-  auto extract_OTU_stats(std::unordered_map<std::string, struct OTU> &OTUs)
-    -> std::vector<struct OTU_stats> {
-    // goal is to get a sortable list of OTUs
-    std::vector<struct OTU_stats> sorted_OTUs;
-    sorted_OTUs.reserve(OTUs.size());  // probably 25-50% too much
-    for (auto const& otu: OTUs) {  // replace with copy_if()?
-      auto const& OTU_id {otu.first};
-      if (OTUs[OTU_id].is_merged) { continue; }  // skip merged OTUs
-
-      sorted_OTUs.push_back(OTU_stats {
-          .OTU_id = OTU_id,
-          .spread = OTUs[OTU_id].spread,
-          .abundance = OTUs[OTU_id].sum_reads}
-        );
+
+  // one line per OTU; the buffer must be large enough (see
+  // max_row_length())
+  auto format_row(char * position,
+                  struct OTU const &otu,
+                  unsigned int const n_samples) -> char * {
+    position = std::ranges::copy(otu.id, position).out;
+    if (not otu.is_sparse) {
+      for (auto const& sample: otu.samples) {
+        position = put_number(position, sample);
+      }
+    }
+    else {
+      // sparse: null abundance values are not stored
+      auto next {0UL};
+      for (auto column {0U}; column < n_samples; ++column) {
+        auto const is_stored = next < otu.columns.size() and otu.columns[next] == column;
+        position = put_number(position, is_stored ? otu.samples[next++] : 0UL);
+      }
     }
-    // sort by decreasing abundance, spread and id name
-    std::ranges::sort(sorted_OTUs, std::ranges::greater{});
-    sorted_OTUs.shrink_to_fit();  // reduces memory usage
+    *position = '\n';
+    return std::next(position);
+  }
+
 
-    return sorted_OTUs;
+  auto max_row_length(std::string_view const OTU_id,
+                      unsigned int const n_samples) -> std::size_t {
+    return OTU_id.size() + (n_samples * (max_number_length + 1)) + 1;
   }
+
+
+  // consecutive rows of the new table, formatted by any thread
+  struct Chunk {
+    std::vector<char> buffer;
+    std::atomic<bool> is_done {false};
+  };
 } // namespace
 
 
-auto write_table(std::unordered_map<std::string, struct OTU> &OTUs,
-                 const std::string &new_otu_table_name) -> void {
+auto write_table(std::vector<struct OTU> const &OTUs,
+                 unsigned int const n_samples,
+                 const std::string &new_otu_table_name,
+                 unsigned long int const n_threads) -> void {
   std::cout << "write new OTU table... ";
   // re-open output file
   std::ofstream new_otu_table {new_otu_table_name, std::ios_base::app};
   // list and sort remaining OTUs
-  const auto sorted_OTUs {extract_OTU_stats(OTUs)};
+  const auto sorted_OTUs {sort_OTUs(OTUs, n_threads)};
+
+  // rows are formatted in chunks of about 1 MiB (one buffer per
+  // chunk), and chunks are written in order, with large writes
+  static constexpr auto chunk_size {std::size_t{1} << 20U};
+  static constexpr auto max_pending_chunks {std::size_t{4}};
+  auto const rows_per_chunk {
+    std::max(std::size_t{1}, chunk_size / max_row_length({}, n_samples))};
+  auto const n_chunks {(sorted_OTUs.size() + rows_per_chunk - 1) / rows_per_chunk};
+  std::vector<struct Chunk> chunks(n_chunks);
+
+  auto const format_chunk = [&](std::size_t const chunk_index) -> void {
+    auto & buffer = chunks[chunk_index].buffer;
+    auto const first {chunk_index * rows_per_chunk};
+    auto const last {std::min(first + rows_per_chunk, sorted_OTUs.size())};
+    auto length {0UL};
+    for (auto i {first}; i < last; ++i) {
+      length += max_row_length(OTUs[sorted_OTUs[i]].id, n_samples);
+    }
+    buffer.resize(length);
+    auto * position = buffer.data();
+    for (auto i {first}; i < last; ++i) {
+      position = format_row(position, OTUs[sorted_OTUs[i]], n_samples);
+    }
+    buffer.resize(static_cast<std::size_t>(position - buffer.data()));
+  };
+  auto const write_chunk = [&](std::size_t const chunk_index) -> void {
+    auto & buffer = chunks[chunk_index].buffer;
+    new_otu_table.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer = {};  // release memory
+  };
 
-  // output 
-  for (auto const& otu: sorted_OTUs) {
-    new_otu_table << otu.OTU_id;
-    for (auto const& sample: OTUs[otu.OTU_id].samples) {   // C++23 refactoring: std::views::join_with('\t');
-      new_otu_table << sepchar << sample;
+  if (n_threads == 1) {
+    for (auto i {0UL}; i < n_chunks; ++i) {
+      format_chunk(i);
+      write_chunk(i);
+    }
+  }
+  else {
+    // workers format chunks on demand, but never run too far ahead
+    // of the writer (bounded memory)
+    std::atomic<std::size_t> next_chunk {0};
+    std::atomic<std::size_t> n_written {0};
+    auto const worker = [&]() -> void {
+      while (true) {
+        auto const chunk_index = next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk_index >= n_chunks) { return; }
+        auto written {n_written.load(std::memory_order_acquire)};
+        while (chunk_index >= written + max_pending_chunks * n_threads) {
+          n_written.wait(written, std::memory_order_acquire);
+          written = n_written.load(std::memory_order_acquire);
+        }
+        format_chunk(chunk_index);
+        chunks[chunk_index].is_done.store(true, std::memory_order_release);
+        chunks[chunk_index].is_done.notify_one();
+      }
+    };
+
+    std::vector<std::jthread> workers;
+    workers.reserve(n_threads);
+    for (auto i {0UL}; i < n_threads; ++i) {
+      workers.emplace_back(worker);
+    }
+    for (auto i {0UL}; i < n_chunks; ++i) {
+      chunks[i].is_done.wait(false, std::memory_order_acquire);
+      write_chunk(i);
+      n_written.store(i + 1, std::memory_order_release);
+      n_written.notify_all();
     }
-    new_otu_table << '\n';
   }
   std::cout << "done, " << sorted_OTUs.size() << " entries\n";
 }
@@ -22,7 +22,10 @@
 // France
 
 #include <string>
-#include <unordered_map>
+#include <vector>
 
-auto write_table (std::unordered_map<std::string, struct OTU> &OTUs,
-                  const std::string &new_otu_table_name) -> void;
+// rows are formatted in parallel, and written in order
+auto write_table (std::vector<struct OTU> const &OTUs,
+                  unsigned int n_samples,
+                  const std::string &new_otu_table_name,
+                  unsigned long int n_threads) -> void;
@@ -583,8 +583,8 @@ LOG=$(mktemp)
         success "${DESCRIPTION}"
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
 
-## mumu is not yet multithreaded
-DESCRIPTION="mumu warns that it is not yet multithreaded"
+## mumu is multithreaded
+DESCRIPTION="mumu does not warn about multithreading"
 OTU_TABLE=$(mktemp)
 MATCH_LIST=$(mktemp)
 NEW_OTU_TABLE=$(mktemp)
@@ -596,9 +596,785 @@ LOG=$(mktemp)
     --log "${LOG}" \
     --threads 2 2>&1 > /dev/null | \
     grep -qw "Warning: mumu is not yet multithreaded" && \
+    failure "${DESCRIPTION}" || \
+        success "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
+
+## large tables are split into chunks and parsed in parallel (more
+## than 1 MiB per chunk)
+DESCRIPTION="mumu results do not depend on the number of threads (large OTU table)"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs"
+         for (s = 1; s <= 50; s++) printf "\ts%d", s
+         printf "\n"
+         for (i = 1; i <= 20000; i++) {
+             printf "OTU%d", i
+             for (s = 1; s <= 50; s++) printf "\t%d", (i * s) % 97
+             printf "\n"
+         }
+     }' > "${OTU_TABLE}"
+printf "OTU2\tOTU1\t99.0\nOTU19999\tOTU3\t97.0\n" > "${MATCH_LIST}"
+diff \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list "${MATCH_LIST}" \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 1 2> /dev/null) \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list "${MATCH_LIST}" \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 4 2> /dev/null) > /dev/null && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}"
+
+DESCRIPTION="mumu stops with an error if an OTU name appears in two chunks (large OTU table)"
+OTU_TABLE=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs"
+         for (s = 1; s <= 50; s++) printf "\ts%d", s
+         printf "\n"
+         for (i = 1; i <= 20000; i++) {
+             printf "OTU%d", (i == 20000 ? 1 : i)
+             for (s = 1; s <= 50; s++) printf "\t%d", (i * s) % 97
+             printf "\n"
+         }
+     }' > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --threads 4 2>&1 > /dev/null | \
+    grep -qw "Error: duplicated OTU name: OTU1" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+## large match lists are split into chunks and parsed in parallel
+DESCRIPTION="mumu results do not depend on the number of threads (large match list)"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\n"
+         for (i = 1; i <= 1000; i++) printf "OTU%d\t%d\t%d\n", i, 2000 - i, i % 7
+     }' > "${OTU_TABLE}"
+awk 'BEGIN {
+         for (i = 1; i <= 200000; i++) {
+             printf "OTU%d\tOTU%d\t%.1f\n", (i * 7) % 1000 + 1, (i * 13) % 1000 + 1, 84 + i % 16
+         }
+     }' > "${MATCH_LIST}"
+diff \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list "${MATCH_LIST}" \
+          --new_otu_table /dev/null \
+          --log /dev/stdout \
+          --threads 1 2> /dev/null) \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list "${MATCH_LIST}" \
+          --new_otu_table /dev/null \
+          --log /dev/stdout \
+          --threads 4 2> /dev/null) > /dev/null && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}"
+
+## large new OTU tables are formatted in parallel, and written in order
+DESCRIPTION="mumu new OTU table does not depend on the number of threads (large table)"
+OTU_TABLE=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs"
+         for (j = 1; j <= 200; j++) printf "\ts%d", j
+         printf "\n"
+         for (i = 1; i <= 5000; i++) {
+             printf "OTU%d", i
+             for (j = 1; j <= 200; j++) printf "\t%d", (i * j) % 97 == 0 ? 0 : (i * j) % 100003
+             printf "\n"
+         }
+     }' > "${OTU_TABLE}"
+cmp -s \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list /dev/null \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 1 2> /dev/null) \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list /dev/null \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 4 2> /dev/null) && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+## parent search is multithreaded: log entries are in OTU order
+DESCRIPTION="mumu log does not depend on the number of threads"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+LOG=$(mktemp)
+PARALLEL_LOG=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\ts3\n"
+         for (i = 1; i <= 1000; i++) printf "OTU%d\t%d\t%d\t%d\n", i, 2000 - i, i % 7, i % 3
+     }' > "${OTU_TABLE}"
+awk 'BEGIN {
+         for (i = 1; i <= 20000; i++) {
+             printf "OTU%d\tOTU%d\t%.1f\n", (i * 7) % 1000 + 1, (i * 13) % 1000 + 1, 84 + i % 16
+         }
+     }' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${LOG}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${PARALLEL_LOG}" \
+    --threads 7 > /dev/null 2>&1
+cmp -s "${LOG}" "${PARALLEL_LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${LOG}" "${PARALLEL_LOG}"
+
+DESCRIPTION="mumu reports warnings and errors in input order (large match list)"
+MATCH_LIST=$(mktemp)
+awk 'BEGIN {
+         printf "unknown\tOTU1\t99.0\n"
+         for (i = 1; i <= 200000; i++) printf "OTU2\tOTU1\t99.0\n"
+         printf "OTU2\tOTU1\n"
+     }' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nOTU1\t2\nOTU2\t1\n") \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --threads 4 2>&1 > /dev/null | \
+    awk '/^Warning/ {w = NR} /^Error/ {e = NR} END {exit (w > 0 && e > w) ? 0 : 1}' && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${MATCH_LIST}"
+
+## match lists grouped by query can be processed one query at a time
+DESCRIPTION="mumu accepts the option --grouped_match_list"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --grouped_match_list > /dev/null 2>&1 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu results do not change with --grouped_match_list"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+GROUPED_OTU_TABLE=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\n"
+         for (i = 1; i <= 1000; i++) printf "OTU%d\t%d\t%d\n", i, 2000 - i, i % 7
+     }' > "${OTU_TABLE}"
+awk 'BEGIN {
+         for (i = 1; i <= 20000; i++) {
+             printf "OTU%d\tOTU%d\t%.1f\n", (i * 7) % 1000 + 1, (i * 13) % 1000 + 1, 84 + i % 16
+         }
+     }' | sort -k1,1 > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log /dev/null > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${GROUPED_OTU_TABLE}" \
+    --log /dev/null \
+    --grouped_match_list > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${GROUPED_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${GROUPED_OTU_TABLE}"
+
+DESCRIPTION="mumu stops with an error if --grouped_match_list and match list is not grouped"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t3\nB\t1\nC\t2\n") \
+    --match_list <(printf "B\tA\t99.0\nC\tA\t99.0\nB\tC\t99.0\n") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --grouped_match_list 2>&1 > /dev/null | \
+    grep -qx "Error: match list is not grouped by query OTU (see 'sort -k1,1'): B" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## large match lists can be sorted in temporary files
+DESCRIPTION="mumu results do not change with --memory_budget"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+LOG=$(mktemp)
+SORTED_OTU_TABLE=$(mktemp)
+SORTED_LOG=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\n"
+         for (i = 1; i <= 1000; i++) printf "OTU%d\t%d\t%d\n", i, 2000 - i, i % 7
+     }' > "${OTU_TABLE}"
+awk 'BEGIN {
+         for (i = 1; i <= 200000; i++) {
+             printf "OTU%d\tOTU%d\t%.1f\n", (i * 7) % 1000 + 1, (i * 13) % 1000 + 1, 84 + i % 16
+         }
+     }' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${SORTED_OTU_TABLE}" \
+    --log "${SORTED_LOG}" \
+    --memory_budget 1 > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${SORTED_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log does not change with --memory_budget"
+cmp -s "${LOG}" "${SORTED_LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}" \
+   "${SORTED_OTU_TABLE}" "${SORTED_LOG}"
+
+DESCRIPTION="mumu stops with an error if --temporary_directory does not exist"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --memory_budget 1 \
+    --temporary_directory /nonexistent_directory/ 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## the sort buffer grows with the input, large budgets are not allocated
+DESCRIPTION="mumu accepts a large --memory_budget with a small match list"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/stdout \
+    --log /dev/null \
+    --memory_budget 1000000 2> /dev/null | \
+    grep -qP "^A\t3$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+for BUDGET in 0 -1 1048577 ; do
+    DESCRIPTION="mumu refuses --memory_budget ${BUDGET}"
+    "${MUMU}" \
+        --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+        --match_list <(printf "B\tA\t99.0\n") \
+        --new_otu_table /dev/null \
+        --log /dev/null \
+        --memory_budget "${BUDGET}" 2>&1 > /dev/null | \
+        grep -q "^Error: --memory_budget" && \
+        success "${DESCRIPTION}" || \
+            failure "${DESCRIPTION}"
+done
+
+## mumu stops with an error if log_level is not full, accepted or none
+DESCRIPTION="mumu stops with an error if log_level is not full, accepted or none"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --log_level rejected 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## rejected potential parents are not logged (E has no overlap with C)
+DESCRIPTION="mumu log_level accepted: only accepted parents are logged"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+LOG=$(mktemp)
+FULL_OTU_TABLE=$(mktemp)
+FULL_LOG=$(mktemp)
+printf "OTUs\ts1\ts2\ts3\nA\t10\t10\t0\nE\t0\t0\t50\nC\t2\t2\t0\n" > "${OTU_TABLE}"
+printf "C\tE\t99.0\nC\tA\t99.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${FULL_OTU_TABLE}" \
+    --log "${FULL_LOG}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --log_level accepted > /dev/null 2>&1
+awk 'NR == 2 {is_valid = $2 == "A" && $18 == "accepted"}
+     END {exit is_valid && NR == 2 ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_level accepted: accepted lines do not change"
+grep -qP "\taccepted$" "${FULL_LOG}" && \
+    grep -P "\taccepted$" "${FULL_LOG}" | cmp -s - <(tail -n +2 "${LOG}") && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_level accepted: results do not change"
+cmp -s "${FULL_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_level none: log contains only a header"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --log_level none > /dev/null 2>&1
+awk 'END {exit NR == 1 ? 0 : 1}' "${LOG}" && \
+    cmp -s "${FULL_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_level none: binary log converts to a header"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${FULL_LOG}" \
+    --log_format binary \
+    --log_level none > /dev/null 2>&1
+"${MUMU}" \
+    --log_to_tsv "${FULL_LOG}" \
+    --log "${LOG}" > /dev/null 2>&1
+[[ -s "${FULL_LOG}" ]] && \
+    awk 'END {exit NR == 1 ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}" \
+   "${FULL_OTU_TABLE}" "${FULL_LOG}"
+
+## sweep mode: one new OTU table per parameter set (C is merged with A
+## only if the minimum ratio is low enough)
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+SWEEP=$(mktemp)
+LOG=$(mktemp)
+printf "OTUs\ts1\ts2\nA\t10\t10\nB\t0\t50\nC\t3\t4\nD\t1\t1\n" > "${OTU_TABLE}"
+printf "C\tB\t99.0\nC\tA\t97.0\nD\tA\t99.0\nD\tC\t96.0\n" > "${MATCH_LIST}"
+printf "# comment\n84.0\tmin\t1.0\t0.95\n\n98.0\tmin\t3.0\t0.95\n" > "${SWEEP}"
+
+DESCRIPTION="mumu sweep: one new OTU table per parameter set"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --sweep "${SWEEP}" > /dev/null 2>&1
+[[ -s "${NEW_OTU_TABLE}.1" && -s "${NEW_OTU_TABLE}.2" ]] && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## the path set with --new_otu_table is only used to name new OTU
+## tables: a symbolic link is not removed, and its target is unchanged
+DESCRIPTION="mumu sweep: the file set with --new_otu_table is not used"
+TARGET=$(mktemp)
+printf "unchanged\n" > "${TARGET}"
+rm -f "${NEW_OTU_TABLE}"
+ln -s "${TARGET}" "${NEW_OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --sweep "${SWEEP}" > /dev/null 2>&1
+[[ -L "${NEW_OTU_TABLE}" && -s "${NEW_OTU_TABLE}.1" ]] && \
+    cmp -s "${TARGET}" <(printf "unchanged\n") && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${NEW_OTU_TABLE}" "${TARGET}"
+unset TARGET
+
+DESCRIPTION="mumu sweep: new OTU tables are the same as with separate runs"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log /dev/null > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${NEW_OTU_TABLE}.1" && \
+    "${MUMU}" \
+        --otu_table "${OTU_TABLE}" \
+        --match_list "${MATCH_LIST}" \
+        --new_otu_table "${NEW_OTU_TABLE}" \
+        --log /dev/null \
+        --minimum_match 98.0 \
+        --minimum_ratio 3.0 > /dev/null 2>&1 && \
+    cmp -s "${NEW_OTU_TABLE}" "${NEW_OTU_TABLE}.2" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sweep: summary has one line per parameter set"
+awk -F "\t" 'NR == 1 {n_valid += $1 == "set" && $6 == "merged_OTUs"}
+              NR == 2 {n_valid += $1 == 1 && $2 == "84.0" && $6 == 2 && $7 == 2}
+              NR == 3 {n_valid += $1 == 2 && $2 == "98.0" && $6 == 1 && $7 == 3}
+              END {exit n_valid == 3 && NR == 3 ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sweep stops with an error if a parameter set is invalid"
+printf "84.0\tmax\t1.0\t0.95\n" > "${SWEEP}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --sweep "${SWEEP}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sweep stops with an error if a threshold is out of range"
+printf "84.0\tmin\t1.0\t1.5\n" > "${SWEEP}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --sweep "${SWEEP}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sweep stops with an error if there is no parameter set"
+printf "# comment\n" > "${SWEEP}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --sweep "${SWEEP}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${NEW_OTU_TABLE}".[12] \
+   "${SWEEP}" "${LOG}"
+
+## pair cache: statistics are saved, and then reused
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+PAIR_CACHE=$(mktemp)
+LOG=$(mktemp)
+EXPECTED_OTU_TABLE=$(mktemp)
+EXPECTED_LOG=$(mktemp)
+rm -f "${PAIR_CACHE}"
+printf "OTUs\ts1\ts2\nA\t10\t10\nB\t0\t50\nC\t3\t4\nD\t1\t1\n" > "${OTU_TABLE}"
+printf "C\tB\t99.0\nC\tA\t97.0\nD\tA\t99.0\nD\tC\t96.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${EXPECTED_OTU_TABLE}" \
+    --log "${EXPECTED_LOG}" > /dev/null 2>&1
+
+DESCRIPTION="mumu pair_cache: cache file is created, results do not change"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --pair_cache "${PAIR_CACHE}" > /dev/null 2>&1
+[[ -s "${PAIR_CACHE}" ]] && \
+    cmp -s "${EXPECTED_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    cmp -s "${EXPECTED_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu pair_cache: cache file is reused, results do not change"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --pair_cache "${PAIR_CACHE}" 2> /dev/null | \
+    grep -q "save pair statistics" && \
+    failure "${DESCRIPTION}"
+cmp -s "${EXPECTED_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    cmp -s "${EXPECTED_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu pair_cache: cache file is reused with other thresholds"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${EXPECTED_OTU_TABLE}" \
+    --log "${EXPECTED_LOG}" \
+    --minimum_ratio 3.0 > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --minimum_ratio 3.0 \
+    --pair_cache "${PAIR_CACHE}" > /dev/null 2>&1
+cmp -s "${EXPECTED_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    cmp -s "${EXPECTED_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu pair_cache: cache file is rebuilt if the OTU table changes"
+printf "OTUs\ts1\ts2\nA\t10\t10\nB\t0\t50\nC\t30\t4\nD\t1\t1\n" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${EXPECTED_OTU_TABLE}" \
+    --log "${EXPECTED_LOG}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --pair_cache "${PAIR_CACHE}" > /dev/null 2>&1
+cmp -s "${EXPECTED_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    cmp -s "${EXPECTED_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu pair_cache: warning if input files are not regular files"
+"${MUMU}" \
+    --otu_table <(cat "${OTU_TABLE}") \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" \
+    --pair_cache "${PAIR_CACHE}" 2>&1 > /dev/null | \
+    grep -q "^Warning" && \
+    cmp -s "${EXPECTED_OTU_TABLE}" "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${PAIR_CACHE}" \
+   "${LOG}" "${EXPECTED_OTU_TABLE}" "${EXPECTED_LOG}"
+
+## pair cache: with a small --memory_budget, new pairs are written to
+## sorted runs (repeated matches in several runs), and then merged
+DESCRIPTION="mumu pair_cache: cache file does not change with --memory_budget"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+PAIR_CACHE=$(mktemp)
+SPILLED_PAIR_CACHE=$(mktemp)
+rm -f "${PAIR_CACHE}" "${SPILLED_PAIR_CACHE}"
+awk 'BEGIN {print "OTUs\ts1\ts2\ts3"
+            for (i = 0; i < 300; i++) {
+                print "X" i "\t" 1 + i % 50 "\t" 1 + (i * 7) % 50 "\t" (i * 13) % 51
+            }}' > "${OTU_TABLE}"
+awk 'BEGIN {for (r = 0; r < 2; r++) {
+                for (i = 0; i < 300; i++) {
+                    for (j = 0; j < 300; j++) {
+                        if (i != j && (r == 0 || j % 10 == 0)) print "X" i "\tX" j "\t99.0"
+                    }
+                }
+            }}' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --minimum_ratio 100000 \
+    --pair_cache "${PAIR_CACHE}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --minimum_ratio 100000 \
+    --memory_budget 1 \
+    --pair_cache "${SPILLED_PAIR_CACHE}" > /dev/null 2>&1
+[[ -s "${PAIR_CACHE}" ]] && \
+    cmp -s "${PAIR_CACHE}" "${SPILLED_PAIR_CACHE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## the cache file can't be replaced (it is a directory)
+DESCRIPTION="mumu pair_cache: error if the cache file can't be replaced"
+PAIR_CACHE_DIRECTORY=$(mktemp -d)
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --pair_cache "${PAIR_CACHE_DIRECTORY}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    [[ ! -e "${PAIR_CACHE_DIRECTORY}.tmp" ]] && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rmdir "${PAIR_CACHE_DIRECTORY}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${PAIR_CACHE}" "${SPILLED_PAIR_CACHE}"
+unset PAIR_CACHE_DIRECTORY SPILLED_PAIR_CACHE
+
+## log lines are formatted in a buffer, names can be longer than the buffer
+DESCRIPTION="mumu log accepts very long OTU names"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+LOG=$(mktemp)
+LONG_NAME=$(head -c 2000000 /dev/zero | tr '\0' 'B')
+printf "OTUs\ts1\nA\t2\n%s\t1\n" "${LONG_NAME}" > "${OTU_TABLE}"
+printf "%s\tA\t99.0\n" "${LONG_NAME}" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${LOG}" > /dev/null 2>&1
+awk 'NR == 2 {exit length($1) == 2000000 && $2 == "A" && $18 == "accepted" ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${LOG}"
+unset LONG_NAME
+
+## mumu stops with an error if log_format is not tsv or binary
+DESCRIPTION="mumu stops with an error if log_format is not tsv or binary"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t2\nB\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/null \
+    --log /dev/null \
+    --log_format csv 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## a binary log converted with --log_to_tsv is identical to a tsv log
+## (B and C are rejected, D is accepted)
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+TSV_LOG=$(mktemp)
+BINARY_LOG=$(mktemp)
+LOG=$(mktemp)
+printf "OTUs\ts1\ts2\nA\t10\t10\nB\t0\t50\nC\t9\t0\nD\t1\t1\n" > "${OTU_TABLE}"
+printf "C\tB\t99.0\nC\tA\t97.0\nD\tA\t99.0\nD\tC\t96.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${TSV_LOG}" > /dev/null 2>&1
+
+DESCRIPTION="mumu log_format binary: converted log is identical to tsv log"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${BINARY_LOG}" \
+    --log_format binary > /dev/null 2>&1
+"${MUMU}" \
+    --log_to_tsv "${BINARY_LOG}" \
+    --log "${LOG}" > /dev/null 2>&1
+cmp -s "${TSV_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_format binary: converted log is identical to tsv log (threads)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${BINARY_LOG}" \
+    --log_format binary \
+    --threads 2 > /dev/null 2>&1
+"${MUMU}" \
+    --log_to_tsv "${BINARY_LOG}" \
+    --log "${LOG}" > /dev/null 2>&1
+cmp -s "${TSV_LOG}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_format binary: results do not change"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${LOG}" \
+    --log "${BINARY_LOG}" \
+    --log_format binary > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+PARENT_MAJOR_OTU_TABLE=$(mktemp)
+PARENT_MAJOR_LOG=$(mktemp)
+DESCRIPTION="mumu parent_major: log and results do not change"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${PARENT_MAJOR_OTU_TABLE}" \
+    --log "${PARENT_MAJOR_LOG}" \
+    --parent_major > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${PARENT_MAJOR_OTU_TABLE}" && \
+    cmp -s "${TSV_LOG}" "${PARENT_MAJOR_LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu parent_major: log and results do not change (threads)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${PARENT_MAJOR_OTU_TABLE}" \
+    --log "${PARENT_MAJOR_LOG}" \
+    --parent_major \
+    --threads 2 > /dev/null 2>&1
+cmp -s "${NEW_OTU_TABLE}" "${PARENT_MAJOR_OTU_TABLE}" && \
+    cmp -s "${TSV_LOG}" "${PARENT_MAJOR_LOG}" && \
     success "${DESCRIPTION}" || \
         failure "${DESCRIPTION}"
-rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
+
+DESCRIPTION="mumu log_to_tsv stops with an error if input is not a binary log"
+"${MUMU}" \
+    --log_to_tsv "${TSV_LOG}" \
+    --log "${LOG}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_to_tsv stops with an error if log and binary log are the same file"
+"${MUMU}" \
+    --log_to_tsv "${BINARY_LOG}" \
+    --log "${BINARY_LOG}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_to_tsv leaves the binary log intact when log is the same file"
+"${MUMU}" \
+    --log_to_tsv "${BINARY_LOG}" \
+    --log "${LOG}" > /dev/null 2>&1 && \
+    cmp -s "${LOG}" "${TSV_LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu log_to_tsv stops with an error if log is missing"
+"${MUMU}" \
+    --log_to_tsv "${BINARY_LOG}" 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${TSV_LOG}" \
+   "${BINARY_LOG}" "${LOG}" "${PARENT_MAJOR_OTU_TABLE}" "${PARENT_MAJOR_LOG}"
 
 ## mumu accepts thread values
 DESCRIPTION="mumu accepts thread values"
@@ -822,6 +1598,72 @@ DESCRIPTION="mumu floors decimal abundance values in the OTU table (5.9 -> 5)"
     success "${DESCRIPTION}" || \
         failure "${DESCRIPTION}"
 
+## regular files are memory-mapped, pipes are read line by line:
+## both readers must behave the same
+DESCRIPTION="mumu floors decimal abundance values in the OTU table (regular file, 5.9 -> 5)"
+OTU_TABLE=$(mktemp)
+printf "OTUs\ts1\nA\t5.9\n" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qw "5$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+DESCRIPTION="mumu incorrectly parses negative integer abundance values in the OTU table (regular file)"
+OTU_TABLE=$(mktemp)
+printf "OTUs\ts1\nA\t-1\n" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qw "18446744073709551615$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+DESCRIPTION="mumu accepts OTU table in DOS format (regular file)"
+OTU_TABLE=$(mktemp)
+printf "OTUs\ts1\r\nA\t5\r\n" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/null \
+    --log /dev/null > /dev/null 2>&1 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+DESCRIPTION="mumu accepts OTU table without a final newline (regular file)"
+OTU_TABLE=$(mktemp)
+printf "OTUs\ts1\ts2\nA\t5\t1" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qP "^A\t5\t1$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
+DESCRIPTION="mumu stops with an error if the OTU table has a missing value (regular file)"
+OTU_TABLE=$(mktemp)
+printf "OTUs\ts1\ts2\nA\t5\t\t\n" > "${OTU_TABLE}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list <(printf "") \
+    --new_otu_table /dev/null \
+    --log /dev/null 2>&1 > /dev/null | \
+    grep -q "^Error" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
 DESCRIPTION="mumu stops with an error if the OTU table has a non-numerical value (NA)"
 OTU_TABLE=$(mktemp)
 MATCH_LIST=$(mktemp)
@@ -906,6 +1748,23 @@ printf "A\tB\tNA\n" > "${MATCH_LIST}"
         failure "${DESCRIPTION}"
 rm -f "${OTU_TABLE}" "${MATCH_LIST}"
 
+## similarity values are parsed like std::stod did (leading
+## whitespace, explicit '+' sign, trailing characters are accepted)
+DESCRIPTION="mumu accepts similarity values with a '+' sign or trailing characters"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+printf "OTUs\ts1\nA\t2\nB\t1\nC\t1\n" > "${OTU_TABLE}"
+printf "B\tA\t +96.5\nC\tA\t96.5%%\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    awk '$3 == "96.50" {n++} END {exit n == 2 ? 0 : 1}' && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}"
+
 DESCRIPTION="mumu can read from a substitution process"
 MATCH_LIST=$(mktemp)
 "${MUMU}" \
@@ -1751,6 +2610,84 @@ awk '{if (NR > 1) {exit ($1 == "A" && $2 == 8) ? 0 : 1}}' "${NEW_OTU_TABLE}" &&
         failure "${DESCRIPTION}"
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
 
+# mumu can find the root of long chained merges (X0 <- X1 <- ... <-
+# X999, and Y <- X500), children before their parents
+DESCRIPTION="mumu can find the root of long chained merges"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+awk 'BEGIN {print "OTUs\ts1"
+            for (i = 0; i < 1000; i++) {print "X" i "\t" 1000 + i}
+            print "Y\t1"}' > "${OTU_TABLE}"
+awk 'BEGIN {for (i = 0; i < 999; i++) {print "X" i "\tX" i + 1 "\t99.0"}
+            print "Y\tX500\t99.0"}' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log /dev/null > /dev/null
+awk 'NR == 2 {is_valid = $1 == "X999" && $2 == 1499501}
+     END {exit is_valid && NR == 2 ? 0 : 1}' "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu can find the root of long chained merges (threads)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log /dev/null \
+    --threads 2 > /dev/null
+awk 'NR == 2 {is_valid = $1 == "X999" && $2 == 1499501}
+     END {exit is_valid && NR == 2 ? 0 : 1}' "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}"
+
+## tables with mostly null values are stored in sparse mode
+DESCRIPTION="mumu merges OTUs A and B as expected (sparse table)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\ts2\ts3\ts4\ts5\ts6\nA\t0\t0\t10\t0\t0\t5\nB\t0\t0\t2\t0\t0\t1\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qP "^A\t0\t0\t12\t0\t0\t6$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu merges OTUs with their roots (sparse table, threads)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\ts2\ts3\ts4\ts5\ts6\nA\t0\t0\t10\t0\t0\t5\nC\t8\t0\t0\t0\t0\t0\nB\t0\t0\t2\t0\t0\t1\nD\t1\t0\t0\t0\t0\t0\n") \
+    --match_list <(printf "B\tA\t99.0\nD\tC\t99.0\n") \
+    --threads 2 \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qP "^A\t0\t0\t12\t0\t0\t6$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu merges OTUs A and B as expected (sparse table, partial overlap)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\ts2\ts3\ts4\ts5\ts6\nA\t0\t0\t10\t0\t0\t5\nB\t1\t0\t2\t0\t0\t0\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --minimum_relative_cooccurrence 0.5 \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    grep -qP "^A\t1\t0\t12\t0\t0\t5$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu computes overlap statistics as expected (sparse table, partial overlap)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\ts2\ts3\ts4\ts5\ts6\nA\t0\t0\t10\t0\t0\t5\nB\t1\t0\t2\t0\t0\t0\n") \
+    --match_list <(printf "B\tA\t99.0\n") \
+    --minimum_relative_cooccurrence 0.5 \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep -qP "^B\tA\t99.00\t3\t15\t2\t10\t2\t2\t1\t0.00\t5.00\t2.50\t5.00\t5.00\t5.00\t0.50\taccepted$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
 ## OTUs with the same abundance are not merged
 # A child cannot be as abundant as its parent (to avoid circular linking
 # among OTUs of the same abundance).
@@ -1869,11 +2806,56 @@ printf "OTUs\ts1\na\t1\nB\t1\n" > "${OTU_TABLE}"
     --match_list "${MATCH_LIST}" \
     --new_otu_table "${NEW_OTU_TABLE}" \
     --log "${LOG}" > /dev/null
-awk '{if (NR == 6) {exit ($1 == "a" && $2 == 1) ? 0 : 1}}' "${NEW_OTU_TABLE}" && \
+awk 'NR == 3 {is_valid = $1 == "a" && $2 == 1}
+     END {exit is_valid && NR == 3 ? 0 : 1}' "${NEW_OTU_TABLE}" && \
     success "${DESCRIPTION}" || \
         failure "${DESCRIPTION}"
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
 
+## OTU names are compared eight bytes at a time, then in full
+DESCRIPTION="mumu sorts merged OTUs by ASCIIbetical order (long names with the same prefix)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nabcdefghij\t1\nabcdefgh\t1\nabcdefghi\t1\nabcdefg\t1\n") \
+    --match_list /dev/null \
+    --new_otu_table /dev/stdout \
+    --log /dev/null 2> /dev/null | \
+    awk '$1 ~ /^abc/ {names = names $1 " "}
+         END {exit names == "abcdefg abcdefgh abcdefghi abcdefghij " ? 0 : 1}' && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## large tables are sorted in parallel
+DESCRIPTION="mumu sorts merged OTUs by decreasing abundance, then by spread, then by ASCIIbetical order (threads)"
+OTU_TABLE=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\n"
+         for (i = 1; i <= 50000; i++) printf "OTU%d\t%d\t%d\n", (i * 7919) % 50000, i % 5, i % 3 == 0 ? 0 : 1
+     }' > "${OTU_TABLE}"
+cmp -s \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list /dev/null \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 1 2> /dev/null) \
+    <("${MUMU}" \
+          --otu_table "${OTU_TABLE}" \
+          --match_list /dev/null \
+          --new_otu_table /dev/stdout \
+          --log /dev/null \
+          --threads 3 2> /dev/null) && \
+    "${MUMU}" \
+        --otu_table "${OTU_TABLE}" \
+        --match_list /dev/null \
+        --new_otu_table /dev/stdout \
+        --log /dev/null \
+        --threads 3 2> /dev/null | \
+    awk -F "\t" '/^OTU[0-9]/ {print $2 + $3 "\t" ($2 > 0) + ($3 > 0) "\t" $1}' | \
+    LC_ALL=C sort -c -t "$(printf '\t')" -k1,1nr -k2,2nr -k3,3 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}"
+
 ## it is ok to sort a vector containing only one OTU
 DESCRIPTION="mumu accepts to sort when there is only one OTU"
 OTU_TABLE=$(mktemp)
@@ -2170,6 +3152,96 @@ awk '{if (NR == 2) {exit ($1 == "A" && $2 == 4) ? 0 : 1}}' "${NEW_OTU_TABLE}" &&
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}"
 
 
+## long lists of matches are sorted on packed integer keys: all
+## potential parents are rejected and logged, in test order
+DESCRIPTION="mumu sorts matches by decreasing similarity, abundance, and by ASCIIbetical order (long list)"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+awk 'BEGIN {
+         printf "OTUs\ts1\ts2\nQ\t1\t0\n"
+         for (i = 1; i <= 400; i++) printf "H%d\t0\t%d\n", i, 10 + i % 7
+     }' > "${OTU_TABLE}"
+awk 'BEGIN {
+         for (i = 1; i <= 400; i++) printf "Q\tH%d\t%.1f\n", i, 84 + (i * 37) % 160 / 10
+     }' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep "^Q" | \
+    LC_ALL=C sort -c -t "$(printf '\t')" -k3,3gr -k5,5nr -k2,2 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sorts matches by decreasing similarity, abundance, and by ASCIIbetical order (long list, grouped)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --grouped_match_list \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep "^Q" | \
+    LC_ALL=C sort -c -t "$(printf '\t')" -k3,3gr -k5,5nr -k2,2 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu sorts matches by decreasing similarity, abundance, and by ASCIIbetical order (long list, parent-major)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --parent_major \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep "^Q" | \
+    LC_ALL=C sort -c -t "$(printf '\t')" -k3,3gr -k5,5nr -k2,2 && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu --legacy sorts matches by decreasing abundance, and by input order (long list)"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --legacy \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep "^Q" | \
+    LC_ALL=C sort -c -t "$(printf '\t')" -k5,5nr -k2.2,2n && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${OTU_TABLE}" "${MATCH_LIST}"
+
+## repeated pairs of OTUs are tested in input order
+DESCRIPTION="mumu --legacy sorts repeated matches by input order"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t10\nB\t1\n") \
+    --match_list <(printf "B\tA\t90.0\nB\tA\t95.0\nB\tA\t92.0\n") \
+    --legacy \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep -qP "^B\tA\t90.00\t.*\taccepted$" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+## same with a long list of rejected matches (not only short lists
+## keep their input order)
+DESCRIPTION="mumu --legacy sorts repeated matches by input order (long list)"
+MATCH_LIST=$(mktemp)
+awk 'BEGIN {for (i = 0; i < 40; i++) printf "B\tA\t%.1f\n", 85 + (i * 37) % 150 / 10}' > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\ts2\nA\t30\t1\nB\t1\t20\n") \
+    --match_list "${MATCH_LIST}" \
+    --legacy \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    grep -P "^B\tA\t" | \
+    cut -f 3 | \
+    cmp -s - <(awk '{printf "%.2f\n", $3}' "${MATCH_LIST}") && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+rm -f "${MATCH_LIST}"
+
+
 ## ------------------------------------------------------------------- log file
 
 ## log file has 18 columns (no merge)
@@ -2291,6 +3363,18 @@ awk 'NR > 1 {exit $3 == "96.50" ? 0 : 1}' "${LOG}" && \
         failure "${DESCRIPTION}"
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
 
+## similarity values are stored in double precision (97.565 rounds
+## down to 97.56, but would round up to 97.57 in single precision)
+DESCRIPTION="mumu log column 3 is the percentage of similarity (rounding)"
+"${MUMU}" \
+    --otu_table <(printf "OTUs\ts1\nA\t9\nB\t1\n") \
+    --match_list <(printf "B\tA\t97.565\n") \
+    --new_otu_table /dev/null \
+    --log /dev/stdout 2> /dev/null | \
+    awk 'NR == 2 {exit $3 == "97.56" ? 0 : 1}' && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
 DESCRIPTION="mumu log column 4 is total abundance of the query"
 OTU_TABLE=$(mktemp)
 MATCH_LIST=$(mktemp)
@@ -2738,6 +3822,133 @@ awk 'NR > 1 {exit $7 == 0 ? 0 : 1}' "${LOG}" && \
 rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
 
 
+## mumu when the query is present in a few samples of a large table,
+## ratios are computed for these samples only, with the same results
+DESCRIPTION="mumu low-incidence query: log values are unchanged"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+LOG=$(mktemp)
+awk 'BEGIN {
+    printf "OTUs"
+    for (s = 1; s <= 20; s++) printf "\ts%d", s
+    printf "\nA"
+    for (s = 1; s <= 20; s++) printf "\t%d", (s < 20 ? 10 : 0)
+    printf "\nB"
+    for (s = 1; s <= 20; s++) printf "\t%d", (s == 1 || s == 20 ? 5 : 0)
+    printf "\n"
+}' > "${OTU_TABLE}"
+printf "B\tA\t99.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" > /dev/null 2>&1
+awk 'NR == 2 {is_valid = $6 == 5 && $7 == 10 && $10 == 1 && $11 == 0.00 && \
+                         $12 == 2.00 && $13 == 1.00 && $16 == 2.00}
+     END {exit (NR == 2 && is_valid) ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
+
+
+## mumu when overlap is limited to a few samples of a large table,
+## ratios are computed for shared samples only, with the same results
+DESCRIPTION="mumu few shared samples: log values are unchanged"
+OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+LOG=$(mktemp)
+awk 'BEGIN {
+    printf "OTUs"
+    for (s = 1; s <= 20; s++) printf "\ts%d", s
+    printf "\nA"
+    for (s = 1; s <= 20; s++) printf "\t%d", (s >= 10 ? 10 : 0)
+    printf "\nB"
+    for (s = 1; s <= 20; s++) printf "\t%d", (s <= 10 ? 5 : 0)
+    printf "\n"
+}' > "${OTU_TABLE}"
+printf "B\tA\t99.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" > /dev/null 2>&1
+awk 'NR == 2 {is_valid = $6 == 5 && $7 == 10 && $10 == 1 && $11 == 0.00 && \
+                         $12 == 2.00 && $13 == 0.20 && $16 == 2.00}
+     END {exit (NR == 2 && is_valid) ? 0 : 1}' "${LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+rm -f "${OTU_TABLE}" "${MATCH_LIST}" "${NEW_OTU_TABLE}" "${LOG}"
+
+
+## wide dense OTUs (39 samples) are visited with vectorized kernels
+## when the CPU supports AVX2 or AVX-512, and the last samples one at
+## a time. Parent abundances are close to 2^53, and the smallest ratio
+## (2^53 / (2^53 - 1)) is just above the minimum ratio: B is merged
+## with A. Padded with 156 null samples, the same OTUs fill less than
+## half of the table: they are stored in sparse mode, and ratios are
+## computed one sample at a time (scalar computation). The log is the
+## same
+OTU_TABLE=$(mktemp)
+PADDED_OTU_TABLE=$(mktemp)
+MATCH_LIST=$(mktemp)
+NEW_OTU_TABLE=$(mktemp)
+LOG=$(mktemp)
+PADDED_LOG=$(mktemp)
+WIDE_TABLE='BEGIN {
+    printf "OTUs"
+    for (s = 1; s <= 39 + padding; s++) printf "\ts%d", s
+    printf "\nA"
+    for (s = 1; s <= 39; s++) {
+        if (s == 5) printf "\t0"
+        else if (s == 13) printf "\t9007199254740992"
+        else printf "\t9007199254%06d", 700000 + s * 1001
+    }
+    for (s = 1; s <= padding; s++) printf "\t0"
+    printf "\nB"
+    for (s = 1; s <= 39; s++) {
+        if (s == 22) printf "\t0"
+        else if (s == 13) printf "\t9007199254740991"
+        else printf "\t%d", s * 1000003
+    }
+    for (s = 1; s <= padding; s++) printf "\t0"
+    printf "\n"
+}'
+awk -v padding=0 "${WIDE_TABLE}" > "${OTU_TABLE}"
+awk -v padding=156 "${WIDE_TABLE}" > "${PADDED_OTU_TABLE}"
+printf "B\tA\t99.0\n" > "${MATCH_LIST}"
+"${MUMU}" \
+    --otu_table "${OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table "${NEW_OTU_TABLE}" \
+    --log "${LOG}" > /dev/null 2>&1
+"${MUMU}" \
+    --otu_table "${PADDED_OTU_TABLE}" \
+    --match_list "${MATCH_LIST}" \
+    --new_otu_table /dev/null \
+    --log "${PADDED_LOG}" > /dev/null 2>&1
+
+DESCRIPTION="mumu wide dense table: B is merged with A (vectorized ratios)"
+awk 'NR == 2 {is_valid = $10 == 37 && $14 == "1.00" && $18 == "accepted"}
+     END {exit (NR == 2 && is_valid) ? 0 : 1}' "${LOG}" && \
+    awk 'NR == 2 {is_valid = $1 == "A" && $6 == "5000015" && \
+                             $14 == "18014398509481983" && $23 == "9007199254722022"}
+         END {exit (NR == 2 && is_valid) ? 0 : 1}' "${NEW_OTU_TABLE}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+DESCRIPTION="mumu wide dense table: vectorized and scalar ratios are the same"
+cmp -s "${LOG}" "${PADDED_LOG}" && \
+    success "${DESCRIPTION}" || \
+        failure "${DESCRIPTION}"
+
+rm -f "${OTU_TABLE}" "${PADDED_OTU_TABLE}" "${MATCH_LIST}" \
+   "${NEW_OTU_TABLE}" "${LOG}" "${PADDED_LOG}"
+
+
 # mumu: initial = final + accepted
 DESCRIPTION="mumu: initial = final + accepted"
 OTU_TABLE=$(mktemp)